@@ -1,5 +1,6 @@
 #include "Actor.h"
 #include "StudentWorld.h"
+#include "WorldSnapshot.h"
 #include <iostream>
 
 // Students:  Add code to this file, Actor.h, StudentWorld.h, and StudentWorld.cpp
@@ -8,13 +9,23 @@
 Actor Declarations
 ----------------------------------------------------------------------------
 */
-Actor::Actor(StudentWorld* world, int startX, int startY, int imageID, int hitPoints, int startDir) : 
-	GraphObject(imageID, startX, startY, startDir), m_hitpoints(hitPoints), m_alive(true), m_world(world) 
+Actor::Actor(StudentWorld* world, int startX, int startY, int imageID, int hitPoints, int startDir, unsigned int capabilities) : 
+	GraphObject(world->getGraphObjects(), imageID, startX, startY, startDir), m_hitpoints(hitPoints), m_alive(true), m_kind(imageID), m_spawnOrder(0),
+	m_capabilities(capabilities), m_world(world) 
 	{ setVisible(true); }
 bool Actor::isAlive() const { return m_alive; }
 void Actor::setDead() { m_alive = false; }
 void Actor::decHitPoints(int amt) { m_hitpoints -= amt; }
 StudentWorld* Actor::getWorld() const { return m_world; }
+void Actor::moveTo(int x, int y) {
+	int oldX = getX();
+	int oldY = getY();
+	GraphObject::moveTo(x, y);
+	m_world->actorMoved(this, oldX, oldY);
+}
+int Actor::getKind() const { return m_kind; }
+int Actor::getSpawnOrder() const { return m_spawnOrder; }
+void Actor::setSpawnOrder(int order) { m_spawnOrder = order; }
 void Actor::damage(int damageAmt) { decHitPoints(damageAmt); }
 int Actor::getHitPoints() const { return m_hitpoints; }
 void Actor::setHitPoints(int amt) { m_hitpoints = amt; }
@@ -23,6 +34,29 @@ bool Actor::tryToBeKilled(int damageAmt) {
 	if (m_hitpoints <= 0) setDead();
 	return !isAlive();
 }
+void Actor::decideAndAct() {
+	ActorIntent intent = ActorIntent();
+	decide(intent);
+	act(intent);
+}
+void Actor::saveState(ActorRecord& record) const {
+	record = ActorRecord();
+	record.kind = m_kind;
+	record.spawnOrder = m_spawnOrder;
+	record.x = static_cast<int16_t>(getX());
+	record.y = static_cast<int16_t>(getY());
+	record.direction = getDirection();
+	record.hitPoints = m_hitpoints;
+	record.visible = isVisible();
+	record.stolenGoodie = -1;
+}
+void Actor::loadState(const ActorRecord& record) {
+	m_spawnOrder = record.spawnOrder;
+	// Actors without a direction keep none; setDirection would make it 359
+	if (record.direction != none) setDirection(record.direction);
+	m_hitpoints = record.hitPoints;
+	setVisible(record.visible);
+}
 
 /*
 ----------------------------------------------------------------------------
@@ -30,8 +64,8 @@ Agent Declarations
 ----------------------------------------------------------------------------
 */
 
-Agent::Agent(StudentWorld* world, int startX, int startY, int imageID, int hitPoints, int startDir) : 
-	Actor(world, startX, startY, imageID, hitPoints, startDir) {}
+Agent::Agent(StudentWorld* world, int startX, int startY, int imageID, int hitPoints, int startDir, unsigned int capabilities) : 
+	Actor(world, startX, startY, imageID, hitPoints, startDir, capabilities) {}
 bool Agent::moveIfPossible() {
 	int dir = this->getDirection();
 	switch (dir) {
@@ -50,6 +84,24 @@ bool Agent::moveIfPossible() {
 	}
 	return false;
 }
+bool Agent::moveIfDecided(const ActorIntent& intent) {
+	if (!intent.canMoveAhead) return false;
+	switch (getDirection()) {
+	case up:
+		moveTo(getX(), getY() + 1);
+		break;
+	case down:
+		moveTo(getX(), getY() - 1);
+		break;
+	case left:
+		moveTo(getX() - 1, getY());
+		break;
+	case right:
+		moveTo(getX() + 1, getY());
+		break;
+	}
+	return true;
+}
 bool Agent::handleMovement(int dx, int dy) {
 	if (getWorld()->canAgentMoveTo(this, this->getX(), this->getY(), dx, dy)) {
 		moveTo(this->getX() + dx, this->getY() + dy);
@@ -67,7 +119,7 @@ Player Declarations
 */
 
 Player::Player(StudentWorld* world, int startX, int startY) : 
-	Agent(world, startX, startY, IID_PLAYER, 20, right), m_ammo(20) {}
+	Agent(world, startX, startY, IID_PLAYER, 20, right, DAMAGEABLE), m_ammo(20) {}
 void Player::doSomething() {
 	int key;
 	if (getWorld()->getKey(key)) {
@@ -120,15 +172,21 @@ int Player::getHealthPct() const {
 int Player::getAmmo() const { return m_ammo; }
 void Player::restoreHealth() { setHitPoints(20); }
 void Player::increaseAmmo() { m_ammo += 20; }
+void Player::saveState(ActorRecord& record) const {
+	Agent::saveState(record);
+	record.ammo = m_ammo;
+}
+void Player::loadState(const ActorRecord& record) {
+	Agent::loadState(record);
+	m_ammo = record.ammo;
+}
 
 void Player::addPeaInFront() {
 	int dir = this->getDirection();
 	int dx;
 	int dy;
 	setDxDy(dx, dy);
-	double newX = getX() + dx;
-	double newY = getY() + dy;
-	getWorld()->addActor(new Pea(getWorld(), (int)newX, (int)newY, getDirection()));
+	getWorld()->createActor<Pea>(getX() + dx, getY() + dy, getDirection());
 }
 
 void Player::setDxDy(int &dx, int &dy){
@@ -157,8 +215,8 @@ Robot Declarations
 ----------------------------------------------------------------------------
 */
 
-Robot::Robot(StudentWorld* world, int startX, int startY, int imageID, int hitPoints, int score, int startDir) : 
-	Agent(world, startX, startY, imageID, hitPoints, startDir), m_score(score), m_ticksUntilActive((28 - getWorld()->getLevel()) / 4) , m_currentTick(0)
+Robot::Robot(StudentWorld* world, int startX, int startY, int imageID, int hitPoints, int score, int startDir, unsigned int capabilities) : 
+	Agent(world, startX, startY, imageID, hitPoints, startDir, DAMAGEABLE | SCHEDULED | capabilities), m_score(score), m_ticksUntilActive((28 - getWorld()->getLevel()) / 4) , m_nextActiveTick(0)
 	{ if (m_ticksUntilActive < 3) m_ticksUntilActive = 3; }
 
 void Robot::damage(int damageAmt) {
@@ -173,25 +231,26 @@ void Robot::damage(int damageAmt) {
 }
 int Robot::shootingSound() const { return SOUND_ENEMY_FIRE; }
 
-bool Robot::isResting() {
-	m_currentTick++;
-	if (m_currentTick >= m_ticksUntilActive) {
-		m_currentTick = 0;
-		return false;
-	}
-	return true;
+int Robot::getRestTicks() const { return m_ticksUntilActive; }
+int Robot::getNextActiveTick() const { return m_nextActiveTick; }
+void Robot::setNextActiveTick(int tick) { m_nextActiveTick = tick; }
+void Robot::saveState(ActorRecord& record) const {
+	Agent::saveState(record);
+	record.nextActiveTick = m_nextActiveTick;
+}
+void Robot::loadState(const ActorRecord& record) {
+	Agent::loadState(record);
+	m_nextActiveTick = record.nextActiveTick;
 }
 
 void Robot::addPeaInFront() {
 	int dir = this->getDirection();
 	int dx, dy;
 	setDxDy(dx, dy);
-	double newX = getX() + dx;
-	double newY = getY() + dy;
-	getWorld()->addActor(new Pea(getWorld(), (int)newX, (int)newY, getDirection()));
+	getWorld()->createActor<Pea>(getX() + dx, getY() + dy, getDirection());
 }
 
-void Robot::setDxDy(int& dx, int& dy) {
+void Robot::setDxDy(int& dx, int& dy) const {
 	int dir = this->getDirection();
 	dx = 0;
 	dy = 0;
@@ -220,17 +279,20 @@ RageBot Declarations
 
 RageBot::RageBot(StudentWorld* world, int startX, int startY, int startDir) : 
 	Robot(world, startX, startY, IID_RAGEBOT, 10, 100, startDir) {}
-void RageBot::doSomething() {
-	if (!isAlive()) return;
-	if (isResting()) return;
+void RageBot::decide(ActorIntent& intent) const {
 	int dx, dy;
 	setDxDy(dx, dy);
-	if (getWorld()->existsClearShotToPlayer((int)getX(), (int)getY(), dx, dy)) {
+	intent.hasClearShot = getWorld()->existsClearShotToPlayer(getX(), getY(), dx, dy);
+	intent.canMoveAhead = getWorld()->isOpenToRobots(getX() + dx, getY() + dy);
+}
+void RageBot::act(const ActorIntent& intent) {
+	if (!isAlive()) return;
+	if (intent.hasClearShot) {
 		getWorld()->playSound(shootingSound());
 		addPeaInFront();
 		return;
 	}
-	if (!moveIfPossible()) {
+	if (!moveIfDecided(intent)) {
 		int dir = getDirection();
 		switch (dir) {
 		case up:
@@ -257,11 +319,11 @@ ThiefBot Declarations
 
 
 ThiefBot::ThiefBot(StudentWorld* world, int startX, int startY, int imageID, int hitPoints, int score) : 
-	Robot(world, startX, startY, imageID, hitPoints, score, right), m_stolenGoodie(nullptr), m_distanceBeforeTurning(0) {}
+	Robot(world, startX, startY, imageID, hitPoints, score, right, COUNTS_IN_FACTORY_CENSUS), m_stolenGoodie(nullptr), m_distanceBeforeTurning(0) {}
 
 void ThiefBot::doDifferentiatedDyingStuff() {
-	int thiefBotX = (int)getX();
-	int thiefBotY = (int)getY();
+	int thiefBotX = getX();
+	int thiefBotY = getY();
 	if (m_stolenGoodie != nullptr) {
 		if (getStolenGoodie() != nullptr) {
 			getStolenGoodie()->moveTo(thiefBotX, thiefBotY);
@@ -274,13 +336,26 @@ void ThiefBot::setStolenGoodie(Actor* goodie) { m_stolenGoodie = goodie; }
 bool ThiefBot::isReachedDistance() {
 	m_distanceBeforeTurning--;
 	if (m_distanceBeforeTurning < 1) {
-		m_distanceBeforeTurning = randInt(1, 6);
+		m_distanceBeforeTurning = getWorld()->randInt(1, 6);
 		return true;
 	}
 	return false;
 }
+void ThiefBot::saveState(ActorRecord& record) const {
+	Robot::saveState(record);
+	record.distanceBeforeTurning = m_distanceBeforeTurning;
+	if (m_stolenGoodie != nullptr) record.stolenGoodie = m_stolenGoodie->getSpawnOrder();
+}
+void ThiefBot::loadState(const ActorRecord& record) {
+	Robot::loadState(record);
+	m_distanceBeforeTurning = record.distanceBeforeTurning;
+	// The goodie was made before the ThiefBot stole it, so it is already
+	// back in the world
+	m_stolenGoodie = nullptr;
+	if (record.stolenGoodie >= 0) m_stolenGoodie = getWorld()->getActorBySpawnOrder(record.stolenGoodie);
+}
 void ThiefBot::setRandomDirection() {
-	int dir = randInt(0, 3);
+	int dir = getWorld()->randInt(0, 3);
 	switch (dir) {
 	case 0:
 		setDirection(up);
@@ -304,16 +379,18 @@ Regular ThiefBot Declarations
 
 RegularThiefBot::RegularThiefBot(StudentWorld* world, int startX, int startY) : 
 	ThiefBot(world, startX, startY, IID_THIEFBOT, 5, 10) {}
-void RegularThiefBot::doSomething() { 
+void RegularThiefBot::decide(ActorIntent& intent) const {
+	int dx, dy;
+	setDxDy(dx, dy);
+	intent.stealable = getWorld()->getColocatedStealable(getX(), getY());
+	intent.canMoveAhead = getWorld()->isOpenToRobots(getX() + dx, getY() + dy);
+}
+void RegularThiefBot::act(const ActorIntent& intent) { 
 	if (!isAlive()) return;
-	if (isResting()) return;
-	
-	int thiefBotX = (int)getX();
-	int thiefBotY = (int)getY();
 
-	Actor* stealableItemAtRobotLocation = getWorld()->getColocatedStealable(thiefBotX, thiefBotY);
+	Actor* stealableItemAtRobotLocation = intent.stealable;
 	if (stealableItemAtRobotLocation != nullptr && getStolenGoodie() == nullptr) {
-		if (randInt(1, 10) == 1) {
+		if (getWorld()->randInt(1, 10) == 1) {
 			getWorld()->playSound(SOUND_ROBOT_MUNCH);
 			setStolenGoodie(stealableItemAtRobotLocation);
 			stealableItemAtRobotLocation->moveTo(0, 0);
@@ -343,7 +420,7 @@ void RegularThiefBot::doSomething() {
 		}
 	}
 	else {
-		moveIfPossible();
+		moveIfDecided(intent);
 	}
 
 }
@@ -356,16 +433,19 @@ Mean ThiefBot Declarations
 
 MeanThiefBot::MeanThiefBot(StudentWorld* world, int startX, int startY) :
 	ThiefBot(world, startX, startY, IID_MEAN_THIEFBOT, 8, 20) {}
-void MeanThiefBot::doSomething() {
+void MeanThiefBot::decide(ActorIntent& intent) const {
+	int dx, dy;
+	setDxDy(dx, dy);
+	intent.stealable = getWorld()->getColocatedStealable(getX(), getY());
+	intent.hasClearShot = getWorld()->existsClearShotToPlayer(getX(), getY(), dx, dy);
+	intent.canMoveAhead = getWorld()->isOpenToRobots(getX() + dx, getY() + dy);
+}
+void MeanThiefBot::act(const ActorIntent& intent) {
 	if (!isAlive()) return;
-	if (isResting()) return;
-
-	int thiefBotX = (int)getX();
-	int thiefBotY = (int)getY();
 
-	Actor* stealableItemAtRobotLocation = getWorld()->getColocatedStealable(thiefBotX, thiefBotY);
+	Actor* stealableItemAtRobotLocation = intent.stealable;
 	if (stealableItemAtRobotLocation != nullptr && getStolenGoodie() == nullptr) {
-		if (randInt(1, 10) == 1) {
+		if (getWorld()->randInt(1, 10) == 1) {
 			getWorld()->playSound(SOUND_ROBOT_MUNCH);
 			setStolenGoodie(stealableItemAtRobotLocation);
 			stealableItemAtRobotLocation->moveTo(0, 0);
@@ -374,9 +454,7 @@ void MeanThiefBot::doSomething() {
 		}
 	}
 
-	int dx, dy;
-	setDxDy(dx, dy);
-	if (getWorld()->existsClearShotToPlayer(thiefBotX, thiefBotY, dx, dy)) {
+	if (intent.hasClearShot) {
 		getWorld()->playSound(shootingSound());
 		addPeaInFront();
 		return;
@@ -404,26 +482,18 @@ void MeanThiefBot::doSomething() {
 		}
 	}
 	else {
-		moveIfPossible();
+		moveIfDecided(intent);
 	}
 }
 
-/*
-----------------------------------------------------------------------------
-Wall Declarations
-----------------------------------------------------------------------------
-*/
-
-Wall::Wall(StudentWorld* world, int startX, int startY) : 
-	Actor(world, startX, startY, IID_WALL, -1, none) {}
-
 /*
 ----------------------------------------------------------------------------
 Marble Declarations
 ----------------------------------------------------------------------------
 */
 
-Marble::Marble(StudentWorld* world, int startX, int startY) : Actor(world, startX, startY, IID_MARBLE, 10, none) {}
+Marble::Marble(StudentWorld* world, int startX, int startY) : 
+	Actor(world, startX, startY, IID_MARBLE, 10, none, DAMAGEABLE | SWALLOWABLE | INERT) {}
 void Marble::damage(int damageAmt) { tryToBeKilled(damageAmt); }
 bool Marble::bePushedBy(Agent* a, int x, int y) {
 	if (a->canPushMarbles() && getWorld()->canMarbleMoveTo(x, y)) {
@@ -439,10 +509,10 @@ Pit Declarations
 ----------------------------------------------------------------------------
 */
 Pit::Pit(StudentWorld* world, int startX, int startY) : 
-	Actor(world, startX, startY, IID_PIT, -1, none) {}
-void Pit::doSomething() {
-	if (!isAlive()) return;
-	getWorld()->swallowSwallowable(this);
+	Actor(world, startX, startY, IID_PIT, -1, none, ALLOWS_MARBLE | INERT | REACTS_TO_SWALLOWABLE) {}
+void Pit::sharedSquareWith(Actor* other) {
+	if (!isAlive() || !other->isAlive()) return;
+	if (other->isSwallowable()) getWorld()->swallowSwallowable(this);
 }
 
 /*
@@ -451,12 +521,39 @@ Pea Declarations
 ----------------------------------------------------------------------------
 */
 
-Pea::Pea(StudentWorld* world, int startX, int startY, int startDir) : Actor(world, startX, startY, IID_PEA, -1, startDir) {}
-void Pea::doSomething(){ 
+Pea::Pea(StudentWorld* world, int startX, int startY, int startDir) : 
+	Actor(world, startX, startY, IID_PEA, -1, startDir, ALLOWS_AGENT_COLOCATION) {}
+void Pea::decide(ActorIntent& intent) const {
+	int aheadX, aheadY;
+	switch (getDirection()) {
+		case up:
+			aheadX = getX();
+			aheadY = getY() + 1;
+			break;
+		case down:
+			aheadX = getX();
+			aheadY = getY() - 1;
+			break;
+		case left:
+			aheadX = getX() - 1;
+			aheadY = getY();
+			break;
+		default:
+			aheadX = getX() + 1;
+			aheadY = getY();
+			break;
+	}
+	intent.peaStopsHere = getWorld()->wouldStopPea(getX(), getY());
+	intent.peaStopsAhead = getWorld()->wouldStopPea(aheadX, aheadY);
+}
+void Pea::act(const ActorIntent& intent) {
 	if (!isAlive()) return;
-	if (getWorld()->damageSomething(this, 2)) return;
+	if (intent.peaStopsHere) {
+		getWorld()->damageSomething(this, 2);
+		return;
+	}
 	movePeaForward();
-	if (getWorld()->damageSomething(this, 2)) return;
+	if (intent.peaStopsAhead) getWorld()->damageSomething(this, 2);
 }
 
 void Pea::movePeaForward() {
@@ -485,25 +582,32 @@ ThiefBotFactory Declarations
 
 
 ThiefBotFactory::ThiefBotFactory(StudentWorld* world, int startX, int startY, ThiefBotFactory::ProductType type) : 
-	Actor(world, startX, startY, IID_ROBOT_FACTORY, -1, none), m_productionType(type) {}
+	Actor(world, startX, startY, IID_ROBOT_FACTORY, -1, none, STOPS_PEA), m_productionType(type) {}
 
-void ThiefBotFactory::doSomething() { 
+void ThiefBotFactory::decide(ActorIntent& intent) const {
 	int censusDistance = 3;
-	int robotsInCensus = 0;
-	int factoryX = (int)getX();
-	int factoryY = (int)getY();
-	if (getWorld()->doFactoryCensus(factoryX, factoryY, censusDistance, robotsInCensus)) {
-		if (robotsInCensus < 3 && randInt(1, 50) == 1) {
+	intent.censusCount = 0;
+	intent.censusPermitted = getWorld()->doFactoryCensus(getX(), getY(), censusDistance, intent.censusCount);
+}
+void ThiefBotFactory::act(const ActorIntent& intent) { 
+	int factoryX = getX();
+	int factoryY = getY();
+	if (intent.censusPermitted) {
+		if (intent.censusCount < 3 && getWorld()->randInt(1, 50) == 1) {
 			getWorld()->playSound(SOUND_ROBOT_BORN);
 			if (m_productionType == ThiefBotFactory::MEAN) {
-				getWorld()->addActor(new MeanThiefBot(getWorld(), factoryX, factoryY));
+				getWorld()->createActor<MeanThiefBot>(factoryX, factoryY);
 			} else if (m_productionType == ThiefBotFactory::REGULAR){
-				getWorld()->addActor(new RegularThiefBot(getWorld(), factoryX, factoryY));
+				getWorld()->createActor<RegularThiefBot>(factoryX, factoryY);
 			}
 		}
 	}
 
 }
+void ThiefBotFactory::saveState(ActorRecord& record) const {
+	Actor::saveState(record);
+	record.productType = m_productionType;
+}
 
 /*
 ----------------------------------------------------------------------------
@@ -512,32 +616,46 @@ Exit Item Declarations
 */
 
 Exit::Exit(StudentWorld* world, int startX, int startY) :
-	Actor(world, startX, startY, IID_EXIT, -1, none), m_revealed(false)
+	Actor(world, startX, startY, IID_EXIT, -1, none, ALLOWS_AGENT_COLOCATION | INERT | REACTS_TO_PLAYER | WAITS_FOR_CRYSTALS),
+	m_revealed(false)
 	{ setVisible(false); }
-void Exit::doSomething() {
-	if (!getWorld()->anyCrystals() && !isRevealed()) {
-		reveal();
-		getWorld()->playSound(SOUND_REVEAL_EXIT);
-		setVisible(true);
+void Exit::sharedSquareWith(Actor* other) {
+	if (isRevealed() && other == getWorld()->getPlayer()) {
+		getWorld()->setLevelFinished();
 	}
-	if (isRevealed() && getWorld()->isPlayerColocatedWith(this)) {
+}
+void Exit::allCrystalsCollected() {
+	if (isRevealed()) return;
+	reveal();
+	getWorld()->playSound(SOUND_REVEAL_EXIT);
+	setVisible(true);
+	if (getWorld()->isPlayerColocatedWith(this)) {
 		getWorld()->setLevelFinished();
 	}
 }
 
 bool Exit::isRevealed() { return m_revealed; }
 void Exit::reveal() { m_revealed = true; }
+void Exit::saveState(ActorRecord& record) const {
+	Actor::saveState(record);
+	record.revealed = m_revealed;
+}
+void Exit::loadState(const ActorRecord& record) {
+	Actor::loadState(record);
+	m_revealed = record.revealed;
+}
 /*
 ----------------------------------------------------------------------------
 Pickupable Item Declarations
 ----------------------------------------------------------------------------
 */
 
-PickupableItem::PickupableItem(StudentWorld* world, int startX, int startY, int imageID, int score) :
-	Actor(world, startX, startY, imageID, -1, none), m_score(score) {}
-void PickupableItem::doSomething() {
+PickupableItem::PickupableItem(StudentWorld* world, int startX, int startY, int imageID, int score, unsigned int capabilities) :
+	Actor(world, startX, startY, imageID, -1, none, ALLOWS_AGENT_COLOCATION | INERT | REACTS_TO_PLAYER | capabilities),
+	m_score(score) {}
+void PickupableItem::sharedSquareWith(Actor* other) {
 	if (!isAlive()) return;
-	if (getWorld()->isPlayerColocatedWith(this)) {
+	if (other == getWorld()->getPlayer()) {
 		getWorld()->playSound(SOUND_GOT_GOODIE);
 		getWorld()->increaseScore(m_score);
 		doDifferentiatedStuff();
@@ -564,7 +682,7 @@ Goodie Declarations
 */
 
 Goodie::Goodie(StudentWorld* world, int startX, int startY, int imageID, int score) : 
-	PickupableItem(world, startX, startY, imageID, score) {}
+	PickupableItem(world, startX, startY, imageID, score, STEALABLE) {}
 /*
 ----------------------------------------------------------------------------
 ExtraLifeGoodie Declarations
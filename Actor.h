@@ -5,15 +5,58 @@
 
 class StudentWorld;
 class Agent;
+class Actor;
+struct ActorRecord;
+
+// What an actor learns from the world's read-only queries at the start of
+// its turn, before it changes anything.  Normally an actor decides and
+// then acts straight away; in a two-phase tick the world has many actors
+// decide at once, in parallel, and then has each act in turn.
+struct ActorIntent
+{
+    bool hasClearShot;      // could it hit the player by firing ahead?
+    bool canMoveAhead;      // is the square ahead open to it?
+    Actor* stealable;       // a stealable item on its square, if any
+    bool censusPermitted;   // did its factory census succeed...
+    int censusCount;        // ...and if so, how many robots did it count?
+    bool peaStopsHere;      // would a pea be stopped on its square...
+    bool peaStopsAhead;     // ...or on the square ahead?
+};
 
 class Actor : public GraphObject
 {
 public:
-    Actor(StudentWorld* world, int startX, int startY, int imageID, int hitPoints, int startDir);
+    // Properties that never change for a given kind of actor.  They are
+    // kept as bits in one word so the world can test them without a
+    // virtual call.
+    enum Capability {
+        ALLOWS_AGENT_COLOCATION  = 1 << 0,
+        ALLOWS_MARBLE            = 1 << 1,
+        COUNTS_IN_FACTORY_CENSUS = 1 << 2,
+        STOPS_PEA                = 1 << 3,
+        DAMAGEABLE               = 1 << 4,
+        SWALLOWABLE              = 1 << 5,
+        STEALABLE                = 1 << 6,
+        INERT                    = 1 << 7,  // doSomething never does anything
+        SCHEDULED                = 1 << 8,  // a Robot the world wakes when due
+        REACTS_TO_PLAYER         = 1 << 9,  // wants sharedSquareWith the player
+        WAITS_FOR_CRYSTALS       = 1 << 10, // wants an allCrystalsCollected call
+        REACTS_TO_SWALLOWABLE    = 1 << 11  // wants sharedSquareWith swallowable actors
+    };
+
+    Actor(StudentWorld* world, int startX, int startY, int imageID, int hitPoints, int startDir,
+        unsigned int capabilities = 0);
 
     // Action to perform each tick
     virtual void doSomething() = 0;
 
+    // The two halves of doSomething for actors that can split their turn.
+    // decide only asks the world questions and fills in intent; act does
+    // the rest of the turn from intent.  Actors that don't split their
+    // turn just do something when asked to act.
+    virtual void decide(ActorIntent& /* intent */) const {}
+    virtual void act(const ActorIntent& /* intent */) { doSomething(); }
+
     // Is this actor alive?
     bool isAlive() const;
 
@@ -26,20 +69,36 @@ public:
     // Get this actor's world
     StudentWorld* getWorld() const;
 
+    // Move to x,y and let the world know this actor changed squares
+    virtual void moveTo(int x, int y);
+
+    // What kind of actor this is, identified by its image ID
+    int getKind() const;
+
+    // Order in which this actor was added to the world
+    int getSpawnOrder() const;
+    void setSpawnOrder(int order);
+
+    // Get all of this actor's Capability bits
+    unsigned int getCapabilities() const { return m_capabilities; }
+
+    // Does this actor have all of the given Capability bits?
+    bool hasCapability(unsigned int capability) const { return (m_capabilities & capability) == capability; }
+
     // Can an agent occupy the same square as this actor?
-    virtual bool allowsAgentColocation() const { return false; }
+    bool allowsAgentColocation() const { return hasCapability(ALLOWS_AGENT_COLOCATION); }
 
     // Can a marble occupy the same square as this actor?
-    virtual bool allowsMarble() const { return false; }
+    bool allowsMarble() const { return hasCapability(ALLOWS_MARBLE); }
 
     // Does this actor count when a factory counts items near it?
-    virtual bool countsInFactoryCensus() const { return false; }
+    bool countsInFactoryCensus() const { return hasCapability(COUNTS_IN_FACTORY_CENSUS); }
 
     // Does this actor stop peas from continuing?
-    virtual bool stopsPea() const { return false; }
+    bool stopsPea() const { return hasCapability(STOPS_PEA); }
 
     // Can this actor be damaged by peas?
-    virtual bool isDamageable() const { return false; }
+    bool isDamageable() const { return hasCapability(DAMAGEABLE); }
 
     // Cause this Actor to sustain damageAmt hit points of damage.
     virtual void damage(int damageAmt);
@@ -48,10 +107,23 @@ public:
     virtual bool bePushedBy(Agent* a, int x, int y) { return false; }
 
     // Can this actor be swallowed by a pit?
-    virtual bool isSwallowable() const { return false; }
+    bool isSwallowable() const { return hasCapability(SWALLOWABLE); }
 
     // Can this actor be picked up by a ThiefBot?
-    virtual bool isStealable() const { return false; }
+    bool isStealable() const { return hasCapability(STEALABLE); }
+
+    // Can the world skip calling doSomething on this actor?
+    bool isInert() const { return hasCapability(INERT); }
+
+    // Called by the world when other and this actor come to be on the
+    // same square, for actors that are REACTS_TO_PLAYER when other is the
+    // player, and for actors that are REACTS_TO_SWALLOWABLE when other is
+    // swallowable.
+    virtual void sharedSquareWith(Actor* /* other */) { return; }
+
+    // Called by the world, for actors that are WAITS_FOR_CRYSTALS, when
+    // the last crystal on the level has been collected.
+    virtual void allCrystalsCollected() { return; }
 
     // How many hit points does this actor have left?
     virtual int getHitPoints() const;
@@ -63,9 +135,21 @@ public:
     // actor, and false otherwise.
     virtual bool tryToBeKilled(int damageAmt);
 
+    // Decide, then act on the decision: doSomething for actors that split
+    // their turn.
+    void decideAndAct();
+
+    // Copy this actor's state into record, or take it from record.  (The
+    // world makes an actor of record's kind on record's square first.)
+    virtual void saveState(ActorRecord& record) const;
+    virtual void loadState(const ActorRecord& record);
+
 private:
     int m_hitpoints;
     bool m_alive;
+    int m_kind;
+    int m_spawnOrder;
+    unsigned int m_capabilities;
     StudentWorld* m_world;
 };
 
@@ -73,13 +157,17 @@ class Agent : public Actor
 {
 public:
     Agent(StudentWorld* world, int startX, int startY, int imageID,
-        int hitPoints, int startDir);
+        int hitPoints, int startDir, unsigned int capabilities = 0);
 
     // Move to the adjacent square in the direction the agent is facing
     // if it is not blocked, and return true.  Return false if the agent
     // can't move.
     bool moveIfPossible();
 
+    // Move to the adjacent square in the direction the agent is facing if
+    // intent says it is open, and return true.  Return false otherwise.
+    bool moveIfDecided(const ActorIntent& intent);
+
     // Return true if this agent can push marbles (which means it's the
     // player).
     virtual bool canPushMarbles() const { return false; }
@@ -99,7 +187,6 @@ class Player : public Agent
 public:
     Player(StudentWorld* world, int startX, int startY);
     virtual void doSomething();
-    virtual bool isDamageable() const { return true; }
     virtual void damage(int damageAmt);
     virtual bool canPushMarbles() const { return true; }
     //virtual bool needsClearShot() const; IS FALSE
@@ -116,6 +203,9 @@ public:
 
     // Increase player's amount of ammunition.
     void increaseAmmo();
+
+    virtual void saveState(ActorRecord& record) const;
+    virtual void loadState(const ActorRecord& record);
 private:
     int m_ammo;
     void addPeaInFront();
@@ -126,9 +216,7 @@ class Robot : public Agent
 {
 public:
     Robot(StudentWorld* world, int startX, int startY, int imageID,
-        int hitPoints, int score, int startDir);
-    virtual void doSomething() const { return; }
-    virtual bool isDamageable() const { return true; }
+        int hitPoints, int score, int startDir, unsigned int capabilities = 0);
     virtual void damage(int damageAmt);
     virtual bool canPushMarbles() const { return false; }
     virtual bool needsClearShot() const { return true; }
@@ -136,14 +224,24 @@ public:
 
     // Does this robot shoot?
     virtual bool isShootingRobot() const { return true; }
-    bool isResting();
+
+    // How many ticks pass from one action of this robot to the next.  The
+    // world only calls doSomething on the ticks the robot is active.
+    int getRestTicks() const;
+
+    // The tick on which this robot next acts
+    int getNextActiveTick() const;
+    void setNextActiveTick(int tick);
 
     void addPeaInFront();
-    void setDxDy(int& dx, int& dy);
+    void setDxDy(int& dx, int& dy) const;
+
+    virtual void saveState(ActorRecord& record) const;
+    virtual void loadState(const ActorRecord& record);
 private:
     int m_score;
     int m_ticksUntilActive;
-    int m_currentTick;
+    int m_nextActiveTick;
     virtual void doDifferentiatedDyingStuff() = 0;
 };
 
@@ -151,7 +249,9 @@ class RageBot : public Robot
 {
 public:
     RageBot(StudentWorld* world, int startX, int startY, int startDir);
-    virtual void doSomething();
+    virtual void doSomething() { decideAndAct(); }
+    virtual void decide(ActorIntent& intent) const;
+    virtual void act(const ActorIntent& intent);
 private:
     virtual void doDifferentiatedDyingStuff() { return; }
 };
@@ -162,11 +262,12 @@ public:
     ThiefBot(StudentWorld* world, int startX, int startY, int imageID,
         int hitPoints, int score);
     virtual void doSomething() { return; }
-    virtual bool countsInFactoryCensus() const { return true; }
     Actor* getStolenGoodie();
     void setStolenGoodie(Actor* goodie);
     bool isReachedDistance();
     void setRandomDirection();
+    virtual void saveState(ActorRecord& record) const;
+    virtual void loadState(const ActorRecord& record);
 private:
     int m_distanceBeforeTurning;
     Actor* m_stolenGoodie;
@@ -177,7 +278,9 @@ class RegularThiefBot : public ThiefBot
 {
 public:
     RegularThiefBot(StudentWorld* world, int startX, int startY);
-    virtual void doSomething();
+    virtual void doSomething() { decideAndAct(); }
+    virtual void decide(ActorIntent& intent) const;
+    virtual void act(const ActorIntent& intent);
     virtual bool isShootingRobot() const { return false; }
 };
 
@@ -185,37 +288,32 @@ class MeanThiefBot : public ThiefBot
 {
 public:
     MeanThiefBot(StudentWorld* world, int startX, int startY);
-    virtual void doSomething();
+    virtual void doSomething() { decideAndAct(); }
+    virtual void decide(ActorIntent& intent) const;
+    virtual void act(const ActorIntent& intent);
 };
 
 class Exit : public Actor
 {
 public:
     Exit(StudentWorld* world, int startX, int startY);
-    virtual void doSomething();
-    virtual bool allowsAgentColocation() const { return true; }
+    virtual void doSomething() { return; }
+    virtual void sharedSquareWith(Actor* other);
+    virtual void allCrystalsCollected();
+    virtual void saveState(ActorRecord& record) const;
+    virtual void loadState(const ActorRecord& record);
 private:
     bool m_revealed;
     bool isRevealed();
     void reveal();
 };
 
-class Wall : public Actor
-{
-public:
-    Wall(StudentWorld* world, int startX, int startY);
-    virtual void doSomething() { return; }
-    virtual bool stopsPea() const { return true; }
-};
-
 class Marble : public Actor
 {
 public:
     Marble(StudentWorld* world, int startX, int startY);
     virtual void doSomething() { return; }
-    virtual bool isDamageable() const { return true; }
     virtual void damage(int damageAmt);
-    virtual bool isSwallowable() const { return true; } 
     virtual bool bePushedBy(Agent* a, int x, int y);
 };
 
@@ -223,16 +321,17 @@ class Pit : public Actor
 {
 public:
     Pit(StudentWorld* world, int startX, int startY);
-    virtual void doSomething();
-    virtual bool allowsMarble() const { return true; }
+    virtual void doSomething() { return; }
+    virtual void sharedSquareWith(Actor* other);
 };
 
 class Pea : public Actor
 {
 public:
     Pea(StudentWorld* world, int startX, int startY, int startDir);
-    virtual void doSomething();
-    virtual bool allowsAgentColocation() const { return true; }
+    virtual void doSomething() { decideAndAct(); }
+    virtual void decide(ActorIntent& intent) const;
+    virtual void act(const ActorIntent& intent);
 private:
     void movePeaForward();
 };
@@ -243,8 +342,10 @@ public:
     enum ProductType { REGULAR, MEAN };
 
     ThiefBotFactory(StudentWorld* world, int startX, int startY, ProductType type);
-    virtual void doSomething();
-    virtual bool stopsPea() const { return true; }
+    virtual void doSomething() { decideAndAct(); }
+    virtual void decide(ActorIntent& intent) const;
+    virtual void act(const ActorIntent& intent);
+    virtual void saveState(ActorRecord& record) const;
 private:
     ProductType m_productionType;
 };
@@ -252,9 +353,10 @@ private:
 class PickupableItem : public Actor
 {
 public:
-    PickupableItem(StudentWorld* world, int startX, int startY, int imageID, int score);
-    virtual void doSomething();
-    virtual bool allowsAgentColocation() const { return true; }
+    PickupableItem(StudentWorld* world, int startX, int startY, int imageID, int score,
+        unsigned int capabilities = 0);
+    virtual void doSomething() { return; }
+    virtual void sharedSquareWith(Actor* other);
 private:
     int m_score;
     virtual void doDifferentiatedStuff() = 0;
@@ -273,7 +375,6 @@ class Goodie : public PickupableItem
 public:
     Goodie(StudentWorld* world, int startX, int startY, int imageID,
         int score);
-    virtual bool isStealable() const { return true; }
 private:
     virtual void doDifferentiatedStuff() = 0;
 };
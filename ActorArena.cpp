@@ -0,0 +1,88 @@
+#include "ActorArena.h"
+#include <new>
+
+namespace
+{
+	const std::size_t SLOTS_PER_BLOCK = 64;
+
+	// Each slot starts with the index of the pool it belongs to, padded
+	// so the object after it is suitably aligned.
+	const std::size_t HEADER_SIZE = alignof(std::max_align_t);
+
+	std::size_t roundUp(std::size_t size)
+	{
+		return (size + HEADER_SIZE - 1) / HEADER_SIZE * HEADER_SIZE;
+	}
+}
+
+ActorArena::ActorArena()
+{
+}
+
+ActorArena::~ActorArena()
+{
+	for (std::size_t i = 0; i < m_pools.size(); i++)
+		for (std::size_t b = 0; b < m_pools[i].blocks.size(); b++)
+			::operator delete(m_pools[i].blocks[b]);
+}
+
+void* ActorArena::allocate(std::size_t size)
+{
+	std::size_t slotSize = HEADER_SIZE + roundUp(size);
+
+	std::size_t poolIndex = 0;
+	while (poolIndex < m_pools.size() && m_pools[poolIndex].slotSize != slotSize)
+		poolIndex++;
+	if (poolIndex == m_pools.size())
+	{
+		Pool pool;
+		pool.slotSize = slotSize;
+		pool.currentBlock = 0;
+		pool.slotsUsedInCurrentBlock = 0;
+		pool.freeList = nullptr;
+		m_pools.push_back(pool);
+	}
+	Pool& pool = m_pools[poolIndex];
+
+	char* slot;
+	if (pool.freeList != nullptr)
+	{
+		slot = static_cast<char*>(pool.freeList);
+		pool.freeList = *reinterpret_cast<void**>(slot + HEADER_SIZE);
+	}
+	else
+	{
+		if (pool.currentBlock < pool.blocks.size() && pool.slotsUsedInCurrentBlock == SLOTS_PER_BLOCK)
+		{
+			pool.currentBlock++;
+			pool.slotsUsedInCurrentBlock = 0;
+		}
+		if (pool.currentBlock == pool.blocks.size())
+			pool.blocks.push_back(static_cast<char*>(::operator new(SLOTS_PER_BLOCK * slotSize)));
+		slot = pool.blocks[pool.currentBlock] + pool.slotsUsedInCurrentBlock * slotSize;
+		pool.slotsUsedInCurrentBlock++;
+	}
+
+	*reinterpret_cast<std::size_t*>(slot) = poolIndex;
+	return slot + HEADER_SIZE;
+}
+
+void ActorArena::deallocate(void* p)
+{
+	if (p == nullptr)
+		return;
+	char* slot = static_cast<char*>(p) - HEADER_SIZE;
+	Pool& pool = m_pools[*reinterpret_cast<std::size_t*>(slot)];
+	*reinterpret_cast<void**>(p) = pool.freeList;
+	pool.freeList = slot;
+}
+
+void ActorArena::releaseAll()
+{
+	for (std::size_t i = 0; i < m_pools.size(); i++)
+	{
+		m_pools[i].currentBlock = 0;
+		m_pools[i].slotsUsedInCurrentBlock = 0;
+		m_pools[i].freeList = nullptr;
+	}
+}
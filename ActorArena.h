@@ -0,0 +1,47 @@
+#ifndef ACTORARENA_H_
+#define ACTORARENA_H_
+
+#include <cstddef>
+#include <vector>
+
+// Memory for the actors of one level.  Slots are carved out of large
+// blocks, one pool per slot size, so loading a level costs a few block
+// allocations rather than one per actor.  A destroyed actor's slot goes
+// on its pool's free list and is reused by the next actor of that size
+// (peas and ThiefBots are recycled this way).  releaseAll forgets every
+// slot at once but keeps the blocks for the next level.
+
+class ActorArena
+{
+public:
+	ActorArena();
+	~ActorArena();
+
+	// Return uninitialized memory for an object of the given size.
+	void* allocate(std::size_t size);
+
+	// Return memory obtained from allocate to its pool.  The object that
+	// lived there must already have been destroyed.
+	void deallocate(void* p);
+
+	// Make every slot available again without returning any blocks.
+	void releaseAll();
+
+private:
+	struct Pool
+	{
+		std::size_t slotSize;
+		std::vector<char*> blocks;
+		std::size_t currentBlock;
+		std::size_t slotsUsedInCurrentBlock;
+		void* freeList;
+	};
+
+	std::vector<Pool> m_pools;
+
+	// Prevent copying or assigning ActorArenas
+	ActorArena(const ActorArena&);
+	ActorArena& operator=(const ActorArena&);
+};
+
+#endif // ACTORARENA_H_
@@ -0,0 +1,109 @@
+#include "BatchRunner.h"
+using namespace std;
+
+BatchRunner::BatchRunner(int numThreads)
+ : m_numThreads(numThreads < 1 ? 1 : numThreads), m_queues(m_numThreads),
+   m_doJob(nullptr), m_batch(0), m_busyWorkers(0), m_stopping(false)
+{
+	  // The thread that calls run is worker 0
+	for (int t = 1; t < m_numThreads; t++)
+		m_workers.push_back(thread(&BatchRunner::waitForBatches, this, t));
+}
+
+BatchRunner::~BatchRunner()
+{
+	{
+		lock_guard<mutex> lock(m_batchMutex);
+		m_stopping = true;
+	}
+	m_batchStarted.notify_all();
+	for (size_t t = 0; t < m_workers.size(); t++)
+		m_workers[t].join();
+}
+
+void BatchRunner::run(int numJobs, const function<void(int)>& doJob)
+{
+	for (int job = 0; job < numJobs; job++)
+	{
+		JobQueue& queue = m_queues[job % m_numThreads];
+		lock_guard<mutex> lock(queue.mutex);
+		queue.jobs.push_back(job);
+	}
+
+	if (!m_workers.empty())
+	{
+		{
+			lock_guard<mutex> lock(m_batchMutex);
+			m_doJob = &doJob;
+			m_busyWorkers = static_cast<int>(m_workers.size());
+			m_batch++;
+		}
+		m_batchStarted.notify_all();
+	}
+	work(0, doJob);
+	if (!m_workers.empty())
+	{
+		unique_lock<mutex> lock(m_batchMutex);
+		m_batchFinished.wait(lock, [this]() { return m_busyWorkers == 0; });
+		m_doJob = nullptr;
+	}
+}
+
+void BatchRunner::waitForBatches(int worker)
+{
+	unsigned long lastBatch = 0;
+	for (;;)
+	{
+		const function<void(int)>* doJob;
+		{
+			unique_lock<mutex> lock(m_batchMutex);
+			m_batchStarted.wait(lock, [&]() { return m_stopping || m_batch != lastBatch; });
+			if (m_stopping)
+				return;
+			lastBatch = m_batch;
+			doJob = m_doJob;
+		}
+		work(worker, *doJob);
+		{
+			lock_guard<mutex> lock(m_batchMutex);
+			m_busyWorkers--;
+		}
+		m_batchFinished.notify_one();
+	}
+}
+
+void BatchRunner::work(int worker, const function<void(int)>& doJob)
+{
+	int job;
+	while (takeJob(worker, job))
+		doJob(job);
+}
+
+bool BatchRunner::takeJob(int worker, int& job)
+{
+	{
+		JobQueue& own = m_queues[worker];
+		lock_guard<mutex> lock(own.mutex);
+		if (!own.jobs.empty())
+		{
+			job = own.jobs.front();
+			own.jobs.pop_front();
+			return true;
+		}
+	}
+
+	  // A batch's jobs are all queued before any thread starts on it, so
+	  // once every queue is empty there is nothing left to do
+	for (int i = 1; i < m_numThreads; i++)
+	{
+		JobQueue& victim = m_queues[(worker + i) % m_numThreads];
+		lock_guard<mutex> lock(victim.mutex);
+		if (!victim.jobs.empty())
+		{
+			job = victim.jobs.back();
+			victim.jobs.pop_back();
+			return true;
+		}
+	}
+	return false;
+}
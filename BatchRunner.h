@@ -0,0 +1,60 @@
+#ifndef BATCHRUNNER_H_
+#define BATCHRUNNER_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Runs batches of independent jobs -- whole games, or the decisions of a
+// tick's actors -- on a pool of threads.  The threads are started once,
+// when the pool is made, and wait between batches, so a batch costs a
+// wakeup rather than a thread per job.  A batch's jobs are dealt out
+// evenly to begin with; a thread that finishes its own jobs takes jobs
+// from the far end of another thread's queue, so one thread drawing
+// several long jobs doesn't leave the rest idle.
+
+class BatchRunner
+{
+public:
+	BatchRunner(int numThreads);
+	~BatchRunner();
+
+	  // Call doJob(i) once for each i from 0 to numJobs - 1, on any of the
+	  // threads, and return when every call has returned.  The calling
+	  // thread is one of the pool's threads.  Only one batch runs at once.
+	void run(int numJobs, const std::function<void(int)>& doJob);
+
+	int getNumThreads() const
+	{
+		return m_numThreads;
+	}
+
+private:
+	struct JobQueue
+	{
+		std::mutex mutex;
+		std::deque<int> jobs;
+	};
+
+	int m_numThreads;
+	std::vector<JobQueue> m_queues;
+	std::vector<std::thread> m_workers;
+
+	  // The batch the workers are on, and how many are still at it
+	std::mutex m_batchMutex;
+	std::condition_variable m_batchStarted;
+	std::condition_variable m_batchFinished;
+	const std::function<void(int)>* m_doJob;
+	unsigned long m_batch;
+	int m_busyWorkers;
+	bool m_stopping;
+
+	void waitForBatches(int worker);
+	void work(int worker, const std::function<void(int)>& doJob);
+	bool takeJob(int worker, int& job);
+};
+
+#endif // BATCHRUNNER_H_
@@ -0,0 +1,445 @@
+#include "StudentWorld.h"
+#include "Actor.h"
+#include "Level.h"
+#include "LevelGenerator.h"
+#include "RandomGenerator.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <list>
+#include <chrono>
+#include <cstdlib>
+using namespace std;
+
+  // Times the world's query and movement primitives one at a time on
+  // synthetic levels, to catch slowdowns in those hot paths and to measure
+  // changes to the data structures behind them.
+  //
+  //   MarbleMadnessBenchmark [--density D[,D...]] [--seed N] [--rounds N]
+  //                          [--out FILE] [--compare FILE] [--tolerance PCT]
+  //
+  // Each density is the chance that an inner square of a level holds
+  // something.  Results are written as JSON, to FILE or standard output.
+  // With --compare, each result is also checked against the matching one
+  // in a saved baseline; the comparison goes to standard error, and the
+  // exit status is 1 if anything got more than PCT percent (default 10)
+  // slower.
+
+struct BenchmarkResult
+{
+	string name;
+	double density;
+	long operations;
+	double nanosecondsPerOperation;
+};
+
+static void usage()
+{
+	cerr << "usage: MarbleMadnessBenchmark [--density D[,D...]] [--seed N] [--rounds N]" << endl;
+	cerr << "                              [--out FILE] [--compare FILE] [--tolerance PCT]" << endl;
+}
+
+  // Put entry on the first inner square that holds neither the player
+  // nor the exit, unless the level already has one
+static void ensureOne(Level& lev, Level::MazeEntry entry)
+{
+	for (int y = 1; y < VIEW_HEIGHT - 1; y++)
+	{
+		for (int x = 1; x < VIEW_WIDTH - 1; x++)
+		{
+			if (lev.getContentsOf(x, y) == entry)
+				return;
+		}
+	}
+	for (int y = 1; y < VIEW_HEIGHT - 1; y++)
+	{
+		for (int x = 1; x < VIEW_WIDTH - 1; x++)
+		{
+			Level::MazeEntry here = lev.getContentsOf(x, y);
+			if (here != Level::player && here != Level::exit)
+			{
+				lev.setContentsOf(x, y, entry);
+				return;
+			}
+		}
+	}
+}
+
+  // A generated level with each inner square filled with chance density,
+  // and at least one RageBot and one pit to time queries with
+static Level makeSyntheticLevel(double density, uint64_t seed)
+{
+	Level lev = LevelGenerator(seed).generate(LevelDensities::evenly(density));
+	ensureOne(lev, Level::horiz_ragebot);
+	ensureOne(lev, Level::pit);
+	return lev;
+}
+
+  // Every actor of the level in play, other than the player
+static vector<Actor*> allActors(const StudentWorld& world)
+{
+	vector<Actor*> actors;
+	for (int y = 0; y < VIEW_HEIGHT; y++)
+	{
+		for (int x = 0; x < VIEW_WIDTH; x++)
+		{
+			list<Actor*> here;
+			world.getActorsAtPosition(x, y, here);
+			for (list<Actor*>::iterator itr = here.begin(); itr != here.end(); itr++)
+			{
+				if ((*itr)->getKind() != IID_PLAYER)
+					actors.push_back(*itr);
+			}
+		}
+	}
+	return actors;
+}
+
+  // Run body rounds times and return the result; body returns how many
+  // operations it did.  sink keeps the compiler from skipping the work.
+template<typename Body>
+static BenchmarkResult timeOperations(string name, double density, int rounds, Body body)
+{
+	BenchmarkResult result;
+	result.name = name;
+	result.density = density;
+	result.operations = 0;
+	chrono::steady_clock::duration elapsed(0);
+	for (int round = 0; round < rounds; round++)
+	{
+		auto start = chrono::steady_clock::now();
+		result.operations += body();
+		elapsed += chrono::steady_clock::now() - start;
+	}
+	double nanoseconds = static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(elapsed).count());
+	result.nanosecondsPerOperation = result.operations > 0 ? nanoseconds / result.operations : 0;
+	return result;
+}
+
+static volatile long sink;
+
+static void runBenchmarks(double density, uint64_t seed, int rounds, vector<BenchmarkResult>& results)
+{
+	static const int DX[4] = { 1, -1, 0, 0 };
+	static const int DY[4] = { 0, 0, 1, -1 };
+
+	StudentWorld world("");
+	world.setRandomSeed(seed);
+	world.loadLevel(makeSyntheticLevel(density, seed));
+
+	vector<Actor*> actors = allActors(world);
+	Agent* robot = nullptr;
+	vector<Actor*> pits;
+	for (size_t i = 0; i < actors.size(); i++)
+	{
+		if (actors[i]->getKind() == IID_RAGEBOT && robot == nullptr)
+			robot = static_cast<Agent*>(actors[i]);
+		if (actors[i]->getKind() == IID_PIT)
+			pits.push_back(actors[i]);
+	}
+
+	results.push_back(timeOperations("getActorsAtPosition", density, rounds, [&]() {
+		list<Actor*> here;
+		for (int y = 0; y < VIEW_HEIGHT; y++)
+		{
+			for (int x = 0; x < VIEW_WIDTH; x++)
+			{
+				here.clear();
+				sink += world.getActorsAtPosition(x, y, here);
+			}
+		}
+		return long(VIEW_WIDTH * VIEW_HEIGHT);
+	}));
+
+	  // A robot can't push marbles, so asking for it never changes the world
+	results.push_back(timeOperations("canAgentMoveTo", density, rounds, [&]() {
+		for (int y = 0; y < VIEW_HEIGHT; y++)
+		{
+			for (int x = 0; x < VIEW_WIDTH; x++)
+			{
+				for (int dir = 0; dir < 4; dir++)
+					sink += world.canAgentMoveTo(robot, x, y, DX[dir], DY[dir]);
+			}
+		}
+		return long(VIEW_WIDTH * VIEW_HEIGHT * 4);
+	}));
+
+	results.push_back(timeOperations("canMarbleMoveTo", density, rounds, [&]() {
+		for (int y = 0; y < VIEW_HEIGHT; y++)
+		{
+			for (int x = 0; x < VIEW_WIDTH; x++)
+				sink += world.canMarbleMoveTo(x, y);
+		}
+		return long(VIEW_WIDTH * VIEW_HEIGHT);
+	}));
+
+	results.push_back(timeOperations("existsClearShotToPlayer", density, rounds, [&]() {
+		for (int y = 0; y < VIEW_HEIGHT; y++)
+		{
+			for (int x = 0; x < VIEW_WIDTH; x++)
+			{
+				for (int dir = 0; dir < 4; dir++)
+					sink += world.existsClearShotToPlayer(x, y, DX[dir], DY[dir]);
+			}
+		}
+		return long(VIEW_WIDTH * VIEW_HEIGHT * 4);
+	}));
+
+	results.push_back(timeOperations("doFactoryCensus", density, rounds, [&]() {
+		for (int y = 0; y < VIEW_HEIGHT; y++)
+		{
+			for (int x = 0; x < VIEW_WIDTH; x++)
+			{
+				int count = 0;
+				sink += world.doFactoryCensus(x, y, 3, count) + count;
+			}
+		}
+		return long(VIEW_WIDTH * VIEW_HEIGHT);
+	}));
+
+	  // Nothing is ever on a pit in a fresh level, so this times the check
+	  // that is made on every visit when there is nothing to swallow
+	results.push_back(timeOperations("swallowSwallowableMiss", density, rounds, [&]() {
+		for (size_t i = 0; i < pits.size(); i++)
+			sink += world.swallowSwallowable(pits[i]);
+		return long(pits.size());
+	}));
+
+	  // Each round puts a marble on every pit and times the pits swallowing
+	  // them.  Swallowing kills the pit too, so between rounds both are
+	  // cleared away and the pits laid again.
+	vector<int> pitXs;
+	vector<int> pitYs;
+	for (size_t i = 0; i < pits.size(); i++)
+	{
+		pitXs.push_back(pits[i]->getX());
+		pitYs.push_back(pits[i]->getY());
+	}
+	chrono::steady_clock::duration swallowTime(0);
+	BenchmarkResult swallow;
+	swallow.name = "swallowSwallowable";
+	swallow.density = density;
+	swallow.operations = 0;
+	for (int round = 0; round < rounds; round++)
+	{
+		for (size_t i = 0; i < pits.size(); i++)
+		{
+			if (round > 0)
+				pits[i] = world.createActor<Pit>(pitXs[i], pitYs[i]);
+			world.createActor<Marble>(pitXs[i], pitYs[i]);
+		}
+		auto start = chrono::steady_clock::now();
+		for (size_t i = 0; i < pits.size(); i++)
+			sink += world.swallowSwallowable(pits[i]);
+		swallowTime += chrono::steady_clock::now() - start;
+		swallow.operations += long(pits.size());
+		world.destroyActorsIfDeadHelper();
+	}
+	swallow.nanosecondsPerOperation = swallow.operations > 0 ?
+		static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(swallowTime).count()) / swallow.operations : 0;
+	results.push_back(swallow);
+
+	  // Each round kills a batch of fresh peas and times clearing them out,
+	  // with the rest of the level still there to be walked past
+	const int PEAS_PER_ROUND = 16;
+	RandomGenerator random(seed);
+	chrono::steady_clock::duration destroyTime(0);
+	BenchmarkResult destroy;
+	destroy.name = "destroyActorsIfDeadHelper";
+	destroy.density = density;
+	destroy.operations = 0;
+	for (int round = 0; round < rounds; round++)
+	{
+		for (int i = 0; i < PEAS_PER_ROUND; i++)
+		{
+			int x = random.nextInt(1, VIEW_WIDTH - 2);
+			int y = random.nextInt(1, VIEW_HEIGHT - 2);
+			world.createActor<Pea>(x, y, GraphObject::right)->setDead();
+		}
+		auto start = chrono::steady_clock::now();
+		world.destroyActorsIfDeadHelper();
+		destroyTime += chrono::steady_clock::now() - start;
+		destroy.operations++;
+	}
+	destroy.nanosecondsPerOperation =
+		static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(destroyTime).count()) / destroy.operations;
+	results.push_back(destroy);
+
+	  // Whole ticks, with no keys, on a level of its own; when the level
+	  // ends (mostly by the player being shot) it is laid again, untimed
+	StudentWorld tickWorld("");
+	tickWorld.setRandomSeed(seed);
+	Level tickLevel = makeSyntheticLevel(density, seed);
+	tickWorld.loadLevel(tickLevel);
+	chrono::steady_clock::duration tickTime(0);
+	BenchmarkResult tick;
+	tick.name = "move";
+	tick.density = density;
+	tick.operations = 0;
+	for (int round = 0; round < rounds; round++)
+	{
+		auto start = chrono::steady_clock::now();
+		int status = tickWorld.move();
+		tickTime += chrono::steady_clock::now() - start;
+		tick.operations++;
+		if (status != GWSTATUS_CONTINUE_GAME)
+		{
+			tickWorld.cleanUp();
+			tickWorld.loadLevel(tickLevel);
+		}
+	}
+	tick.nanosecondsPerOperation =
+		static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(tickTime).count()) / tick.operations;
+	results.push_back(tick);
+}
+
+static void writeJson(ostream& out, uint64_t seed, int rounds, const vector<BenchmarkResult>& results)
+{
+	out << "{" << endl;
+	out << "  \"seed\": " << seed << "," << endl;
+	out << "  \"rounds\": " << rounds << "," << endl;
+	out << "  \"results\": [" << endl;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& r = results[i];
+		out << "    { \"name\": \"" << r.name << "\", \"density\": " << r.density
+			<< ", \"operations\": " << r.operations
+			<< ", \"ns_per_op\": " << r.nanosecondsPerOperation << " }"
+			<< (i + 1 < results.size() ? "," : "") << endl;
+	}
+	out << "  ]" << endl;
+	out << "}" << endl;
+}
+
+  // Read the results back out of JSON written by writeJson.  This is not a
+  // general JSON reader: it looks for each result's fields by name.
+static bool readJson(string path, vector<BenchmarkResult>& results)
+{
+	ifstream in(path);
+	if (!in)
+		return false;
+	string line;
+	while (getline(in, line))
+	{
+		size_t name = line.find("\"name\": \"");
+		if (name == string::npos)
+			continue;
+		BenchmarkResult r;
+		name += 9;
+		r.name = line.substr(name, line.find('"', name) - name);
+		size_t density = line.find("\"density\": ");
+		size_t nsPerOp = line.find("\"ns_per_op\": ");
+		if (density == string::npos || nsPerOp == string::npos)
+			return false;
+		r.density = atof(line.c_str() + density + 11);
+		r.nanosecondsPerOperation = atof(line.c_str() + nsPerOp + 13);
+		r.operations = 0;
+		results.push_back(r);
+	}
+	return !results.empty();
+}
+
+  // Report each result beside its baseline and return how many are more
+  // than tolerance percent slower
+static int compare(const vector<BenchmarkResult>& baseline, const vector<BenchmarkResult>& results,
+	double tolerance)
+{
+	int regressions = 0;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		const BenchmarkResult& r = results[i];
+		const BenchmarkResult* before = nullptr;
+		for (size_t j = 0; j < baseline.size(); j++)
+		{
+			if (baseline[j].name == r.name && baseline[j].density == r.density)
+				before = &baseline[j];
+		}
+		cerr << r.name << " @ " << r.density << ": ";
+		if (before == nullptr || before->nanosecondsPerOperation <= 0)
+		{
+			cerr << r.nanosecondsPerOperation << " ns (no baseline)" << endl;
+			continue;
+		}
+		double change = 100 * (r.nanosecondsPerOperation / before->nanosecondsPerOperation - 1);
+		cerr << before->nanosecondsPerOperation << " -> " << r.nanosecondsPerOperation << " ns ("
+			<< (change >= 0 ? "+" : "") << change << "%)";
+		if (change > tolerance)
+		{
+			cerr << "  SLOWER";
+			regressions++;
+		}
+		cerr << endl;
+	}
+	return regressions;
+}
+
+int main(int argc, char* argv[])
+{
+	string densities = "0.1,0.4,0.8";
+	uint64_t seed = 1;
+	int rounds = 2000;
+	string outPath;
+	string comparePath;
+	double tolerance = 10;
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (i + 1 == argc)
+		{
+			usage();
+			return 1;
+		}
+		if (arg == "--density")
+			densities = argv[++i];
+		else if (arg == "--seed")
+			seed = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--rounds")
+			rounds = atoi(argv[++i]);
+		else if (arg == "--out")
+			outPath = argv[++i];
+		else if (arg == "--compare")
+			comparePath = argv[++i];
+		else if (arg == "--tolerance")
+			tolerance = atof(argv[++i]);
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (rounds < 1)
+		rounds = 1;
+
+	vector<BenchmarkResult> baseline;
+	if (!comparePath.empty() && !readJson(comparePath, baseline))
+	{
+		cout << "Cannot read baseline " << comparePath << endl;
+		return 1;
+	}
+
+	vector<BenchmarkResult> results;
+	stringstream densityList(densities);
+	string density;
+	while (getline(densityList, density, ','))
+		runBenchmarks(atof(density.c_str()), seed, rounds, results);
+
+	if (outPath.empty())
+		writeJson(cout, seed, rounds, results);
+	else
+	{
+		ofstream out(outPath);
+		if (!out)
+		{
+			cout << "Cannot write " << outPath << endl;
+			return 1;
+		}
+		writeJson(out, seed, rounds, results);
+	}
+
+	if (!comparePath.empty() && compare(baseline, results, tolerance) > 0)
+		return 1;
+	return 0;
+}
@@ -0,0 +1,103 @@
+#ifndef BITBOARD_H_
+#define BITBOARD_H_
+
+#include "GameConstants.h"
+#include <cstdint>
+
+// A set of board squares stored as one bit per square.  The whole
+// VIEW_WIDTH x VIEW_HEIGHT board fits in four 64-bit words, so combining
+// two boards is a handful of word operations.
+
+class Bitboard
+{
+public:
+	Bitboard()
+	{
+		clear();
+	}
+
+	void clear()
+	{
+		for (int i = 0; i < NUM_WORDS; i++)
+			m_words[i] = 0;
+	}
+
+	bool test(int x, int y) const
+	{
+		if (!isOnBoard(x, y))
+			return false;
+		int bit = bitIndex(x, y);
+		return (m_words[bit / 64] >> (bit % 64)) & 1;
+	}
+
+	void set(int x, int y)
+	{
+		if (!isOnBoard(x, y))
+			return;
+		int bit = bitIndex(x, y);
+		m_words[bit / 64] |= uint64_t(1) << (bit % 64);
+	}
+
+	void reset(int x, int y)
+	{
+		if (!isOnBoard(x, y))
+			return;
+		int bit = bitIndex(x, y);
+		m_words[bit / 64] &= ~(uint64_t(1) << (bit % 64));
+	}
+
+	bool any() const
+	{
+		uint64_t bits = 0;
+		for (int i = 0; i < NUM_WORDS; i++)
+			bits |= m_words[i];
+		return bits != 0;
+	}
+
+	Bitboard operator|(const Bitboard& other) const
+	{
+		Bitboard result;
+		for (int i = 0; i < NUM_WORDS; i++)
+			result.m_words[i] = m_words[i] | other.m_words[i];
+		return result;
+	}
+
+	Bitboard operator&(const Bitboard& other) const
+	{
+		Bitboard result;
+		for (int i = 0; i < NUM_WORDS; i++)
+			result.m_words[i] = m_words[i] & other.m_words[i];
+		return result;
+	}
+
+	bool operator==(const Bitboard& other) const
+	{
+		for (int i = 0; i < NUM_WORDS; i++)
+		{
+			if (m_words[i] != other.m_words[i])
+				return false;
+		}
+		return true;
+	}
+
+	bool operator!=(const Bitboard& other) const
+	{
+		return !(*this == other);
+	}
+
+	static bool isOnBoard(int x, int y)
+	{
+		return x >= 0 && x < VIEW_WIDTH && y >= 0 && y < VIEW_HEIGHT;
+	}
+
+private:
+	static const int NUM_WORDS = (VIEW_WIDTH * VIEW_HEIGHT + 63) / 64;
+	uint64_t m_words[NUM_WORDS];
+
+	static int bitIndex(int x, int y)
+	{
+		return y * VIEW_WIDTH + x;
+	}
+};
+
+#endif // BITBOARD_H_
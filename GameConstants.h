@@ -48,6 +48,7 @@ const int KEY_PRESS_SPACE	= ' ';
 const int KEY_PRESS_ESCAPE	= '\x1b';
 const int KEY_PRESS_TAB    = '\t';
 const int KEY_PRESS_ENTER  = '\r';
+const int INVALID_KEY = 0;
 
 // board dimensions 
 
@@ -75,8 +76,10 @@ int randInt(int min, int max)
 {
 	if (max < min)
 		std::swap(max, min);
-	static std::random_device rd;
-	static std::default_random_engine generator(rd());
+	  // One generator per thread, so worlds running on different threads
+	  // don't race on it
+	static thread_local std::random_device rd;
+	static thread_local std::default_random_engine generator(rd());
 	std::uniform_int_distribution<> distro(min, max);
 	return distro(generator);
 }
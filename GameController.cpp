@@ -176,7 +176,7 @@ void windowCloseCallback()
 
 void GameController::run(int argc, char* argv[], GameWorld* gw, string windowTitle, int msPerTick)
 {
-	gw->setController(this);
+	gw->setHost(this);
 	m_gw = gw;
 	m_msPerTick = msPerTick;
 	setGameState(welcome);
@@ -203,8 +203,11 @@ void GameController::run(int argc, char* argv[], GameWorld* gw, string windowTit
 
 	glutSetOption(GLUT_ACTION_ON_WINDOW_CLOSE, GLUT_ACTION_GLUTMAINLOOP_RETURNS);
 	glutMainLoop();
-	delete m_gw;
+	  // Whatever is still in the world once it has cleaned up was leaked
+	if (m_postInitPreCleanup)
+		m_gw->cleanUp();
 	reportLeakedGraphObjects();
+	delete m_gw;
 }
 
 void GameController::keyboardEvent(unsigned char key, int /* x */, int /* y */)
@@ -326,6 +329,7 @@ void GameController::doSomething()
 					break;
 				}
 			}
+			syncRenderProxies();
 			setGameState(animate);
 			break;
 		case animate:
@@ -400,6 +404,63 @@ void GameController::doSomething()
 }
 
 
+void GameController::syncRenderProxies()
+{
+	m_renderProxies.clear();
+	for (auto it = m_renderStates.begin(); it != m_renderStates.end(); it++)
+		it->second.seen = false;
+
+	std::set<GraphObject*>& graphObjects = m_gw->getGraphObjects();
+	for (auto it = graphObjects.begin(); it != graphObjects.end(); it++)
+	{
+		GraphObject* cur = *it;
+
+		  // A new object, or a new one made where an old one was freed,
+		  // starts at the first frame.  Objects move at most a cell per
+		  // tick, so a new position is one more move, invisible or not.
+		auto found = m_renderStates.find(cur);
+		if (found == m_renderStates.end() || found->second.imageID != static_cast<int>(cur->getID()))
+		{
+			RenderState fresh = { static_cast<int>(cur->getID()), cur->getX(), cur->getY(), 0, false };
+			found = m_renderStates.insert(std::make_pair(cur, fresh)).first;
+			found->second = fresh;  // over any state a freed object left
+		}
+		RenderState& state = found->second;
+		if (cur->getX() != state.x || cur->getY() != state.y)
+		{
+			state.x = cur->getX();
+			state.y = cur->getY();
+			state.animationNumber++;
+		}
+		state.seen = true;
+
+		if (!cur->isVisible())
+			continue;
+
+		RenderProxy proxy;
+		proxy.imageID = cur->getID();
+		proxy.depth = m_imageDepthMap.at(proxy.imageID);
+		proxy.frame = state.animationNumber % m_spriteManager.getNumFrames(proxy.imageID);
+		proxy.angle = cur->getDirection();
+		proxy.x = cur->getX();
+		proxy.y = cur->getY();
+		m_renderProxies.push_back(proxy);
+	}
+
+	  // Forget objects that are gone
+	for (auto it = m_renderStates.begin(); it != m_renderStates.end(); )
+	{
+		if (it->second.seen)
+			it++;
+		else
+			it = m_renderStates.erase(it);
+	}
+	  // Deepest first; stable so objects at one depth keep the order they
+	  // were drawn in before
+	std::stable_sort(m_renderProxies.begin(), m_renderProxies.end(),
+		[](const RenderProxy& a, const RenderProxy& b) { return a.depth > b.depth; });
+}
+
 void GameController::displayGamePlay()
 {
 	glEnable(GL_DEPTH_TEST); // must be done each time before displaying graphics or gets disabled for some reason
@@ -414,26 +475,18 @@ void GameController::displayGamePlay()
 #pragma GCC diagnostic pop
 #endif
 
-  std::set<GraphObject*> &graphObjects = GraphObject::getGraphObjects();
-
+	size_t next = 0;
 	for (int i = GraphObject::NUM_DEPTHS - 1; i >= 0; --i)
 	{
-		for (auto it = graphObjects.begin(); it != graphObjects.end(); it++)
-		{
-			GraphObject* cur = *it;
-			if (m_imageDepthMap.at(cur->getID()) == i && cur->isVisible())
-			{
-				cur->animate();
-
-				double x, y, gx, gy, gz;
-				cur->getAnimationLocation(x, y);
-				convertToGlutCoords(x, y, gx, gy, gz);
+		displayTerrain(i);
 
-				int angle = cur->getDirection();
-				int imageID = cur->getID();
-
-				m_spriteManager.plotSprite(imageID, cur->getAnimationNumber() % m_spriteManager.getNumFrames(imageID), gx, gy, gz, angle, cur->getSize());
-			}
+		for ( ; next < m_renderProxies.size() && m_renderProxies[next].depth == i; next++)
+		{
+			const RenderProxy& cur = m_renderProxies[next];
+			double gx, gy, gz;
+			convertToGlutCoords(cur.x, cur.y, gx, gy, gz);
+			  // Every object is drawn a cell wide
+			m_spriteManager.plotSprite(cur.imageID, cur.frame, gx, gy, gz, cur.angle, 1.0);
 		}
 	}
 
@@ -442,10 +495,27 @@ void GameController::displayGamePlay()
 	glutSwapBuffers();
 }
 
+void GameController::displayTerrain(int depth)
+{
+	for (int y = 0; y < VIEW_HEIGHT; y++)
+	{
+		for (int x = 0; x < VIEW_WIDTH; x++)
+		{
+			int imageID = m_gw->getTerrainAt(x, y);
+			if (imageID < 0 || m_imageDepthMap.at(imageID) != depth)
+				continue;
+
+			double gx, gy, gz;
+			convertToGlutCoords(x, y, gx, gy, gz);
+			m_spriteManager.plotSprite(imageID, 0, gx, gy, gz, GraphObject::none, 1.0);
+		}
+	}
+}
+
 void GameController::reportLeakedGraphObjects() const
 {
 	//int totalLeaked = 0;
-	auto& graphObjects = GraphObject::getGraphObjects();
+	auto& graphObjects = m_gw->getGraphObjects();
 	if (graphObjects.empty())
 		cerr << "No memory leaks were detected." << endl;
 	else
@@ -2,21 +2,22 @@
 #define GAMECONTROLLER_H_
 
 #include "SpriteManager.h"
+#include "GameWorld.h"
 #include <string>
 #include <map>
+#include <unordered_map>
+#include <vector>
 #include <iostream>
 #include <sstream>
-const int INVALID_KEY = 0;
 
 class GraphObject;
-class GameWorld;
 
-class GameController
+class GameController : public GameHost
 {
   public:
 	void run(int argc, char* argv[], GameWorld* gw, std::string windowTitle, int msPerTick);
 
-	bool getKeyIfAny(int& value)
+	virtual bool getKeyIfAny(int& value)
 	{
 		if (m_lastKeyHit != INVALID_KEY)
 		{
@@ -32,9 +33,9 @@ class GameController
 		m_lastKeyHit = key;
 	}
 
-	void playSound(int soundID);
+	virtual void playSound(int soundID);
 
-	void setGameStatText(std::string text)
+	virtual void setGameStatText(std::string text)
 	{
 		m_gameStatText = text;
 	}
@@ -46,7 +47,7 @@ class GameController
 	void specialKeyboardEvent(int key, int x, int y);
 	static void timerFuncCallback(int);
 
-	void quitGame();
+	virtual void quitGame();
 
 	  // Meyers singleton pattern
 	static GameController& getInstance()
@@ -77,11 +78,39 @@ private:
 	SpriteManager m_spriteManager;
 	static int m_msPerTick;
 
+	  // What displayGamePlay needs to draw one visible GraphObject, copied
+	  // from the world once per tick and kept sorted from deepest to
+	  // shallowest so drawing is a single pass over the array.
+	struct RenderProxy
+	{
+		int		imageID;
+		int		depth;
+		int		frame;
+		int		angle;
+		double	x;
+		double	y;
+	};
+	std::vector<RenderProxy> m_renderProxies;
+
+	  // What only drawing needs to know about a GraphObject, kept here by
+	  // object from one sync to the next rather than in the object
+	struct RenderState
+	{
+		int		imageID;
+		int		x;
+		int		y;
+		unsigned int	animationNumber;  // how many moves have been seen
+		bool	seen;                     // by the latest sync
+	};
+	std::unordered_map<const GraphObject*, RenderState> m_renderStates;
+
     void setGameState(GameControllerState s);
 
 	void initDrawersAndSounds();
 	bool passesThruWhenSingleStepping(int key) const;
+	void syncRenderProxies();
 	void displayGamePlay();
+	void displayTerrain(int depth);
 	void reportLeakedGraphObjects() const;
 
 };
@@ -1,27 +1,31 @@
 #include "GameWorld.h"
-#include "GameController.h"
 #include <string>
 #include <cstdlib>
 using namespace std;
 
 bool GameWorld::getKey(int& value)
 {
-	bool gotKey = m_controller->getKeyIfAny(value);
+	if (m_host == nullptr)
+		return false;
+
+	bool gotKey = m_host->getKeyIfAny(value);
 
 	if (gotKey)
 	{
 		if (value == 'q'  ||  value == '\x03')  // CTRL-C
-			m_controller->quitGame();
+			m_host->quitGame();
 	}
 	return gotKey;
 }
 
 void GameWorld::playSound(int soundID)
 {
-	m_controller->playSound(soundID);
+	if (m_host != nullptr)
+		m_host->playSound(soundID);
 }
 
 void GameWorld::setGameStatText(string text)
 {
-	m_controller->setGameStatText(text);
+	if (m_host != nullptr)
+		m_host->setGameStatText(text);
 }
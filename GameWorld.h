@@ -3,10 +3,27 @@
 
 #include "GameConstants.h"
 #include <string>
+#include <set>
 
 const int START_PLAYER_LIVES = 3;
 
-class GameController;
+class GraphObject;
+
+  // Whatever is running a GameWorld: the GameController, or a driver
+  // with no window such as HeadlessGame.  A GameWorld with no host gets
+  // no keys, plays no sounds and shows no text.
+class GameHost
+{
+public:
+	virtual ~GameHost()
+	{
+	}
+
+	virtual bool getKeyIfAny(int& value) = 0;
+	virtual void playSound(int soundID) = 0;
+	virtual void setGameStatText(std::string text) = 0;
+	virtual void quitGame() = 0;
+};
 
 class GameWorld
 {
@@ -14,7 +31,7 @@ public:
 
 	GameWorld(std::string assetPath)
 	 : m_lives(START_PLAYER_LIVES), m_score(0), m_level(0),
-	   m_controller(nullptr), m_assetPath(assetPath)
+	   m_host(nullptr), m_assetPath(assetPath)
 	{
 	}
 
@@ -26,6 +43,13 @@ public:
 	virtual int move() = 0;
 	virtual void cleanUp() = 0;
 
+	  // Image ID of the static terrain at x,y, or -1 if none.  Terrain is
+	  // not made of GraphObjects; the framework draws it as its own layer.
+	virtual int getTerrainAt(int /* x */, int /* y */) const
+	{
+		return -1;
+	}
+
 	void setGameStatText(std::string text);
 
 	bool getKey(int& value);
@@ -72,10 +96,19 @@ public:
 	{
 		++m_level;
 	}
+
+	  // Put the game back to an earlier point, e.g. to play a replay from
+	  // a keyframe
+	void restoreProgress(int level, int score, int lives)
+	{
+		m_level = level;
+		m_score = score;
+		m_lives = lives;
+	}
  
-	void setController(GameController* controller)
+	void setHost(GameHost* host)
 	{
-		m_controller = controller;
+		m_host = host;
 	}
 
 	std::string assetPath() const
@@ -83,12 +116,20 @@ public:
 		return m_assetPath;
 	}
 
+	  // Every GraphObject in this world.  Each world has its own, so that
+	  // several worlds can run side by side in one process.
+	std::set<GraphObject*>& getGraphObjects()
+	{
+		return m_graphObjects;
+	}
+
 private:
 	int				m_lives;
 	int				m_score;
 	int				m_level;
-	GameController* m_controller;
+	GameHost*		m_host;
 	std::string		m_assetPath;
+	std::set<GraphObject*> m_graphObjects;
 };
 
 #endif // GAMEWORLD_H_
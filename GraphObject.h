@@ -1,11 +1,11 @@
 #ifndef GRAPHOBJ_H_
 #define GRAPHOBJ_H_
 
-#include "SpriteManager.h"
 #include "GameConstants.h"
 
 #include <set>
 #include <cmath>
+#include <cstdint>
 
 const int ANIMATION_POSITIONS_PER_TICK = 1;
 
@@ -19,21 +19,22 @@ class GraphObject
 	static const int up = 90;
 	static const int down = 270;
 
-	GraphObject(int imageID, double startX, double startY, int dir = 0, double size = 1.0)
-	 : m_imageID(imageID), m_visible(true), m_x(startX), m_y(startY),
-	   m_destX(startX), m_destY(startY), m_brightness(1.0),
-	   m_animationNumber(0), m_direction(dir), m_size(size)
+	  // registry is the set of GraphObjects of the world this one is in
+	  // (see GameWorld::getGraphObjects).  The object stays in it for as
+	  // long as it exists.
+	GraphObject(std::set<GraphObject*>& registry, int imageID, int startX, int startY,
+	            int dir = 0)
+	 : m_x(static_cast<int16_t>(startX)), m_y(static_cast<int16_t>(startY)),
+	   m_direction(dir), m_imageID(imageID), m_visible(true),
+	   m_registry(&registry)
 	{
-		if (m_size <= 0)
-			m_size = 1;
-
-		getGraphObjects().insert(this);
+		m_registry->insert(this);
 		setVisible(true);
 	}
 
 	virtual ~GraphObject()
 	{
-		getGraphObjects().erase(this);
+		m_registry->erase(this);
 	}
 
 	void setVisible(bool shouldIDisplay)
@@ -41,44 +42,39 @@ class GraphObject
 		m_visible = shouldIDisplay;
 	}
 
-	void setBrightness(double brightness)
+	int getX() const
 	{
-		m_brightness = brightness;
+		return m_x;
 	}
 
-	double getX() const
+	int getY() const
 	{
-		  // If already moved but not yet animated, use new location anyway.
-		return m_destX;
+		return m_y;
 	}
 
-	double getY() const
+	virtual void moveTo(int x, int y)
 	{
-		  // If already moved but not yet animated, use new location anyway.
-		return m_destY;
-	}
-
-	virtual void moveTo(double x, double y)
-	{
-		m_destX = x;
-		m_destY = y;
-		increaseAnimationNumber();
+		m_x = static_cast<int16_t>(x);
+		m_y = static_cast<int16_t>(y);
 	}
 
 	virtual void moveAngle(int angle, int units = 1)
 	{
-		double newX;
-		double newY;
+		int newX;
+		int newY;
 		getPositionInThisDirection(angle, units, newX, newY);
 		moveTo(newX, newY);
-		increaseAnimationNumber();
 	}
 
-	virtual void getPositionInThisDirection(int angle, int units, double& newX, double& newY)
+	  // Objects live on a grid, so only the four right angles are
+	  // meaningful; any other angle is taken as the right angle below it.
+	virtual void getPositionInThisDirection(int angle, int units, int& newX, int& newY)
 	{
-		static const double PI = 4 * atan(1.0);
-		newX = (getX() + units * cos(angle*1.0 / 360 * 2 * PI));
-		newY = (getY() + units * sin(angle*1.0 / 360 * 2 * PI));
+		static constexpr int DX[4] = { 1, 0, -1, 0 };
+		static constexpr int DY[4] = { 0, 1, 0, -1 };
+		int quadrant = ((angle % 360 + 360) % 360) / 90;
+		newX = getX() + units * DX[quadrant];
+		newY = getY() + units * DY[quadrant];
 	}
 
 	void moveForward(int units = 1)
@@ -99,22 +95,6 @@ class GraphObject
 		m_direction = d % 360;
 	}
 
-	void setSize(double size)
-	{
-		m_size = size;
-	}
-
-	double getSize() const
-	{
-		return m_size;
-	}
-
-	double getRadius() const
-	{
-		const int kRadiusPerUnit = 8;
-		return kRadiusPerUnit * m_size;
-	}
-
 	  // The following should be used by only the framework, not the student
 
 	bool isVisible() const
@@ -122,41 +102,6 @@ class GraphObject
 		return m_visible;
 	}
 
-	double getBrightness() const
-	{
-		return m_brightness;
-	}
-
-	unsigned int getAnimationNumber() const
-	{
-		return m_animationNumber;
-	}
-
-	void getAnimationLocation(double& x, double& y) const
-	{
-		x = m_x;
-		y = m_y;
-	}
-
-	void animate()
-	{
-		m_x = m_destX;
-		m_y = m_destY;
-		//moveALittle(m_x, m_destX);
-		//moveALittle(m_y, m_destY);
-	}
-
-	static std::set<GraphObject*>& getGraphObjects()
-	{
-		static std::set<GraphObject*> graphObjects;
-		return graphObjects;
-	}
-
-	void increaseAnimationNumber()
-	{
-		m_animationNumber++;
-	}
-
 
 private:
 	friend class GameController;
@@ -171,29 +116,19 @@ private:
 	GraphObject& operator=(const GraphObject&);
 
 	static const int NUM_DEPTHS = 4;
-	int		m_imageID;
-	bool	m_visible;
-	double	m_x;
-	double	m_y;
-	double	m_destX;
-	double	m_destY;
-	double	m_brightness;
-	int	m_animationNumber;
-	int	m_direction;
-	double	m_size;
-
-	void moveALittle(double& from, double& to)
-	{
-		static const double DISTANCE = 1.0/ANIMATION_POSITIONS_PER_TICK;
-		if (to - from >= DISTANCE)
-			from += DISTANCE;
-		else if (from - to >= DISTANCE)
-			from -= DISTANCE;
-		else
-			from = to;
-	}
 
+	  // What the simulation reads and writes every tick.  Objects move a
+	  // whole cell per tick, so there is no separate animated position.
+	  // What only drawing needs (the animation frame) the GameController
+	  // keeps for itself.
+	int16_t	m_x;
+	int16_t	m_y;
+	int	m_direction;
+	int	m_imageID;
+	bool	m_visible;
 
+	  // Only touched when the object is made or destroyed
+	std::set<GraphObject*>*	m_registry;
 };
 
 #endif // GRAPHOBJ_H_
@@ -0,0 +1,195 @@
+#include "HeadlessGame.h"
+#include "StudentWorld.h"
+#include "GameConstants.h"
+#include <fstream>
+#include <iostream>
+using namespace std;
+
+ScriptedKeySource::ScriptedKeySource()
+ : m_next(0)
+{
+}
+
+bool ScriptedKeySource::loadScript(string path)
+{
+	ifstream ifs(path);
+	if (!ifs)
+		return false;
+
+	m_keys.clear();
+	m_next = 0;
+	string word;
+	while (ifs >> word)
+	{
+		int key;
+		if (word == "left")
+			key = KEY_PRESS_LEFT;
+		else if (word == "right")
+			key = KEY_PRESS_RIGHT;
+		else if (word == "up")
+			key = KEY_PRESS_UP;
+		else if (word == "down")
+			key = KEY_PRESS_DOWN;
+		else if (word == "space")
+			key = KEY_PRESS_SPACE;
+		else if (word == "escape")
+			key = KEY_PRESS_ESCAPE;
+		else if (word == ".")
+			key = INVALID_KEY;
+		else
+		{
+			cerr << path << ": unknown key \"" << word << "\"" << endl;
+			return false;
+		}
+		m_keys.push_back(key);
+	}
+	return true;
+}
+
+bool ScriptedKeySource::getKey(int& value)
+{
+	if (m_next >= m_keys.size())
+		return false;
+	value = m_keys[m_next++];
+	return value != INVALID_KEY;
+}
+
+RandomKeySource::RandomKeySource(unsigned int seed)
+ : m_generator(seed)
+{
+}
+
+bool RandomKeySource::getKey(int& value)
+{
+	  // About one tick in three has a key, and one key in five is a shot
+	static const int KEYS[] = {
+		KEY_PRESS_LEFT, KEY_PRESS_RIGHT, KEY_PRESS_UP, KEY_PRESS_DOWN, KEY_PRESS_SPACE
+	};
+	unsigned int roll = m_generator() % 15;
+	if (roll >= 5)
+		return false;
+	value = KEYS[roll];
+	return true;
+}
+
+ReplayKeySource::ReplayKeySource(const Replay& replay, const StudentWorld& world)
+ : m_events(replay.getKeyEvents()), m_world(world), m_next(0)
+{
+}
+
+bool ReplayKeySource::getKey(int& value)
+{
+	  // Skip keys from before the keyframe the world started from
+	long tick = m_world.getSessionTick();
+	while (m_next < m_events.size() && m_events[m_next].tick < tick)
+		m_next++;
+	if (m_next == m_events.size() || m_events[m_next].tick != tick)
+		return false;
+	value = m_events[m_next++].key;
+	return true;
+}
+
+HeadlessGame::HeadlessGame(GameWorld* gw, KeySource* keys)
+ : m_gw(gw), m_keys(keys), m_quit(false)
+{
+	m_gw->setHost(this);
+}
+
+HeadlessResult HeadlessGame::play(long maxTicks, bool levelInPlay)
+{
+	HeadlessResult result;
+	result.ticks = 0;
+	result.playerWon = false;
+
+	  // The same steps the GameController goes through, minus the prompts
+	  // and animation between them
+	bool levelInProgress = levelInPlay;
+	bool needInit = !levelInPlay;
+	bool gameOver = false;
+	m_quit = false;
+	while (!gameOver && !m_quit)
+	{
+		if (needInit)
+		{
+			int status = m_gw->init();
+			needInit = false;
+			if (status == GWSTATUS_PLAYER_WON)  // no more levels
+			{
+				result.playerWon = true;
+				break;
+			}
+			if (status != GWSTATUS_CONTINUE_GAME)
+			{
+				cerr << "Error in level data file encoding!" << endl;
+				break;
+			}
+			levelInProgress = true;
+		}
+
+		if (result.ticks >= maxTicks)
+			break;
+
+		int status = m_gw->move();
+		result.ticks++;
+		if (m_observe)
+			m_observe(status);
+		switch (status)
+		{
+		  case GWSTATUS_PLAYER_DIED:
+			if (m_undoDeath && m_undoDeath())
+				break;
+			m_gw->cleanUp();
+			levelInProgress = false;
+			needInit = !m_gw->isGameOver();
+			gameOver = m_gw->isGameOver();
+			break;
+		  case GWSTATUS_FINISHED_LEVEL:
+			m_gw->advanceToNextLevel();
+			m_gw->cleanUp();
+			levelInProgress = false;
+			needInit = true;
+			break;
+		  case GWSTATUS_PLAYER_WON:
+			result.playerWon = true;
+			gameOver = true;
+			break;
+		}
+	}
+	if (levelInProgress)
+		m_gw->cleanUp();
+
+	result.score = m_gw->getScore();
+	result.level = m_gw->getLevel();
+	result.lives = m_gw->getLives();
+	return result;
+}
+
+bool HeadlessGame::getKeyIfAny(int& value)
+{
+	if (m_keys == nullptr)
+		return false;
+	return m_keys->getKey(value);
+}
+
+void HeadlessGame::playSound(int /* soundID */)
+{
+}
+
+void HeadlessGame::setGameStatText(string /* text */)
+{
+}
+
+void HeadlessGame::setTickObserver(function<void(int)> observe)
+{
+	m_observe = observe;
+}
+
+void HeadlessGame::setDeathHandler(function<bool()> undoDeath)
+{
+	m_undoDeath = undoDeath;
+}
+
+void HeadlessGame::quitGame()
+{
+	m_quit = true;
+}
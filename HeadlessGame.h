@@ -0,0 +1,113 @@
+#ifndef HEADLESSGAME_H_
+#define HEADLESSGAME_H_
+
+#include "GameWorld.h"
+#include "Replay.h"
+#include <functional>
+#include <string>
+#include <vector>
+#include <random>
+
+class StudentWorld;
+
+// Runs a GameWorld without a window, sound or a keyboard, as fast as the
+// CPU allows, following the same flow from level to level as the
+// GameController.  Keys come from a KeySource, or there are none.
+
+  // Where a headless game's keystrokes come from.  getKey is called
+  // whenever the world asks for a key, which the player does once a tick.
+class KeySource
+{
+public:
+	virtual ~KeySource()
+	{
+	}
+
+	virtual bool getKey(int& value) = 0;
+};
+
+  // Keys read from a script file of whitespace-separated words, one word
+  // per request: left, right, up, down, space, escape, or . for no key.
+  // Once the script runs out there are no more keys.
+class ScriptedKeySource : public KeySource
+{
+public:
+	ScriptedKeySource();
+	bool loadScript(std::string path);
+	virtual bool getKey(int& value);
+
+private:
+	std::vector<int> m_keys;
+	std::size_t m_next;
+};
+
+  // A reproducible stream of random keys, mostly none, for keeping the
+  // player busy under load.  It has its own generator so it doesn't
+  // disturb the game's random numbers.
+class RandomKeySource : public KeySource
+{
+public:
+	RandomKeySource(unsigned int seed);
+	virtual bool getKey(int& value);
+
+private:
+	std::minstd_rand m_generator;
+};
+
+  // The keys of a replay, each pressed on the tick it was recorded on.
+  // Start the world from one of the replay's keyframes.
+class ReplayKeySource : public KeySource
+{
+public:
+	ReplayKeySource(const Replay& replay, const StudentWorld& world);
+	virtual bool getKey(int& value);
+
+private:
+	const std::vector<ReplayKeyEvent>& m_events;
+	const StudentWorld& m_world;
+	std::size_t m_next;
+};
+
+struct HeadlessResult
+{
+	long ticks;
+	int score;
+	int level;
+	int lives;
+	bool playerWon;
+};
+
+class HeadlessGame : public GameHost
+{
+public:
+	HeadlessGame(GameWorld* gw, KeySource* keys = nullptr);
+
+	  // Play from the world's current level until the game is over, the
+	  // player wins, the level data is bad, or maxTicks ticks have passed.
+	  // If levelInPlay, the world already has a level under way (say, from
+	  // a saved game) and play carries on with it rather than starting it.
+	HeadlessResult play(long maxTicks, bool levelInPlay = false);
+
+	  // Call observe(status) after every tick, before the world acts on
+	  // the status the tick returned (say, by cleaning up a finished level)
+	void setTickObserver(std::function<void(int)> observe);
+
+	  // When the player dies, call undoDeath() first.  If it returns true,
+	  // it has undone the death (say, by rewinding the world) and play
+	  // carries on with the level in play.
+	void setDeathHandler(std::function<bool()> undoDeath);
+
+	virtual bool getKeyIfAny(int& value);
+	virtual void playSound(int soundID);
+	virtual void setGameStatText(std::string text);
+	virtual void quitGame();
+
+private:
+	GameWorld*	m_gw;
+	KeySource*	m_keys;
+	bool		m_quit;
+	std::function<void(int)> m_observe;
+	std::function<bool()> m_undoDeath;
+};
+
+#endif // HEADLESSGAME_H_
@@ -0,0 +1,408 @@
+#include "StudentWorld.h"
+#include "HeadlessGame.h"
+#include "BatchRunner.h"
+#include "LevelGenerator.h"
+#include "WorldChecks.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <cstdlib>
+#include <chrono>
+#include <vector>
+using namespace std;
+
+  // Runs the game with no window, sound or keyboard, for load tests,
+  // regression runs and benchmarks on machines without a display.
+  //
+  //   MarbleMadnessHeadless [--assets DIR] [--keys none|random:SEED|FILE]
+  //                         [--ticks N] [--games N] [--threads N] [--seed N]
+  //                         [--record FILE] [--load FILE] [--autosave FILE]
+  //                         [--two-phase N] [--rewind N]
+  //   MarbleMadnessHeadless [--assets DIR] [--ticks N] --replay FILE [--from-tick N]
+  //   MarbleMadnessHeadless generate --out DIR [--count N] [--seed N] [--preset NAME]
+  //                         [--walls D] [--marbles D] [--pits D] [--ragebots D]
+  //                         [--factories D] [--crystals D] [--goodies D]
+  //   MarbleMadnessHeadless check [--assets DIR] [--games N] [--ticks N] [--seed N]
+  //
+  // Each game starts at level 0 and runs until it ends or N ticks pass.
+  // Games run side by side on --threads threads, each in its own world.
+  // With random keys, game i uses key seed SEED + i; with --seed, game i's
+  // world is seeded with N + i, which makes every game repeatable.  See
+  // ScriptedKeySource for the format of a key script file.
+  //
+  // --record saves a single game as a replay (see Replay.h), with a
+  // keyframe at each level start and every 500 ticks.  --replay plays one
+  // back, starting from its last keyframe at or before the --from-tick
+  // tick (0 by default), as fast as possible.
+  //
+  // --load starts a single game from a saved game rather than level 0;
+  // recorded, its replay starts from the loaded game.
+  // --autosave saves a single game every 500 ticks (5 s of play at the
+  // usual speed).
+  //
+  // --two-phase N runs each world's ticks in two phases, its actors'
+  // decisions made on N threads (see StudentWorld::setTwoPhaseTicks).
+  //
+  // --rewind N keeps each world's last N ticks (see
+  // StudentWorld::setRewindLength) and, when the player dies, rewinds it
+  // N ticks and plays on from there instead, if it has kept that many.
+  // A game played this way can't be recorded.
+  //
+  // generate writes N random levels (see LevelGenerator), level00.txt on,
+  // to DIR, which can then be played with --assets DIR.  Densities start
+  // from the preset ("typical" by default) and are changed by the options
+  // that follow it.
+  //
+  // check runs the self-checks in WorldChecks.h on N seeded games (20 by
+  // default) of at most N ticks (5000 by default) each, and exits with
+  // status 1 if any fails.
+
+static const int AUTOSAVE_TICKS = 500;
+
+static void usage()
+{
+	cerr << "usage: MarbleMadnessHeadless [--assets DIR] [--keys none|random:SEED|FILE]" << endl;
+	cerr << "                             [--ticks N] [--games N] [--threads N] [--seed N]" << endl;
+	cerr << "                             [--record FILE] [--load FILE] [--autosave FILE]" << endl;
+	cerr << "                             [--two-phase N] [--rewind N]" << endl;
+	cerr << "       MarbleMadnessHeadless [--assets DIR] [--ticks N] --replay FILE [--from-tick N]" << endl;
+	cerr << "       MarbleMadnessHeadless generate --out DIR [--count N] [--seed N] [--preset NAME]" << endl;
+	cerr << "                             [--walls D] [--marbles D] [--pits D] [--ragebots D]" << endl;
+	cerr << "                             [--factories D] [--crystals D] [--goodies D]" << endl;
+	cerr << "       MarbleMadnessHeadless check [--assets DIR] [--games N] [--ticks N] [--seed N]" << endl;
+}
+
+  // Set assetPath to the path of assetDirectory's levels, checking that
+  // there is at least a level 0 there
+static bool findLevels(string assetDirectory, string& assetPath)
+{
+	assetPath = assetDirectory;
+	if (!assetPath.empty())
+		assetPath += '/';
+	const string someLevel = "level00.txt";
+	ifstream ifs(assetPath + someLevel);
+	if (!ifs)
+	{
+		cout << "Cannot find " << someLevel << " in ";
+		cout << (assetDirectory.empty() ? "current directory" : assetDirectory) << endl;
+		return false;
+	}
+	return true;
+}
+
+static int generateLevels(int argc, char* argv[])
+{
+	string outDirectory;
+	int count = 1;
+	uint64_t seed = 1;
+	LevelDensities densities;
+	LevelDensities::preset("typical", densities);
+
+	for (int i = 2; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (i + 1 == argc)
+		{
+			usage();
+			return 1;
+		}
+		if (arg == "--out")
+			outDirectory = argv[++i];
+		else if (arg == "--count")
+			count = atoi(argv[++i]);
+		else if (arg == "--seed")
+			seed = strtoull(argv[++i], nullptr, 10);
+		else if (arg == "--preset")
+		{
+			if (!LevelDensities::preset(argv[++i], densities))
+			{
+				cout << "Unknown preset " << argv[i] << endl;
+				return 1;
+			}
+		}
+		else if (arg == "--walls")
+			densities.walls = atof(argv[++i]);
+		else if (arg == "--marbles")
+			densities.marbles = atof(argv[++i]);
+		else if (arg == "--pits")
+			densities.pits = atof(argv[++i]);
+		else if (arg == "--ragebots")
+			densities.rageBots = atof(argv[++i]);
+		else if (arg == "--factories")
+			densities.factories = atof(argv[++i]);
+		else if (arg == "--crystals")
+			densities.crystals = atof(argv[++i]);
+		else if (arg == "--goodies")
+			densities.goodies = atof(argv[++i]);
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (outDirectory.empty() || count < 1 || count > 100)
+	{
+		usage();
+		return 1;
+	}
+
+	  // Levels are numbered from 00 to 99, like the game's own
+	LevelGenerator generator(seed);
+	for (int i = 0; i < count; i++)
+	{
+		string name = string("level") + char('0' + i / 10) + char('0' + i % 10) + ".txt";
+		if (!LevelGenerator::writeLevel(outDirectory + "/" + name, generator.generate(densities)))
+		{
+			cout << "Cannot write " << outDirectory << "/" << name << endl;
+			return 1;
+		}
+	}
+	cout << "wrote " << count << " levels to " << outDirectory << endl;
+	return 0;
+}
+
+static void reportGame(int game, const HeadlessResult& result)
+{
+	cout << "game " << game << ": " << (result.playerWon ? "won" : "ended")
+		<< " on level " << result.level << " after " << result.ticks << " ticks, score "
+		<< result.score << ", lives " << result.lives << endl;
+}
+
+static void reportSpeed(long ticks, double seconds, int numThreads)
+{
+	cout << ticks << " ticks in " << seconds << " s on " << numThreads << " threads";
+	if (seconds > 0)
+		cout << " (" << static_cast<long>(ticks / seconds) << " ticks/s)";
+	cout << endl;
+}
+
+static int playReplay(string assetPath, string replayPath, long fromTick, long maxTicks)
+{
+	Replay replay;
+	if (!replay.load(replayPath))
+	{
+		cout << "Cannot read replay " << replayPath << endl;
+		return 1;
+	}
+	int keyframe = replay.findKeyframe(fromTick);
+	if (keyframe < 0)
+		keyframe = 0;
+	const ReplayKeyframe& start = replay.getKeyframes()[keyframe];
+	cout << "starting at tick " << start.tick << " on level " << start.level << endl;
+
+	StudentWorld world(assetPath);
+	world.setRandomSeed(replay.getSeed());
+	bool levelInPlay = !start.world.empty();
+	if (levelInPlay)
+	{
+		WorldSnapshot snapshot;
+		if (!decodeSavedGame(start.world, snapshot))
+		{
+			cout << "Bad keyframe at tick " << start.tick << " in " << replayPath << endl;
+			return 1;
+		}
+		world.restoreSnapshot(snapshot);
+	}
+	else
+		world.restoreKeyframe(start);
+	ReplayKeySource keySource(replay, world);
+	HeadlessGame headless(&world, &keySource);
+
+	auto startTime = chrono::steady_clock::now();
+	HeadlessResult result = headless.play(maxTicks, levelInPlay);
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - startTime).count();
+	reportGame(0, result);
+	reportSpeed(result.ticks, seconds, 1);
+	return 0;
+}
+
+static int runChecks(int argc, char* argv[])
+{
+	string assetDirectory = "Assets";
+	CheckOptions options;
+	options.numGames = 20;
+	options.maxTicks = 5000;
+	options.seed = 1;
+
+	for (int i = 2; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (i + 1 == argc)
+		{
+			usage();
+			return 1;
+		}
+		if (arg == "--assets")
+			assetDirectory = argv[++i];
+		else if (arg == "--games")
+			options.numGames = atoi(argv[++i]);
+		else if (arg == "--ticks")
+			options.maxTicks = atol(argv[++i]);
+		else if (arg == "--seed")
+			options.seed = strtoull(argv[++i], nullptr, 10);
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+	if (!findLevels(assetDirectory, options.assetPath))
+		return 1;
+
+	bool passed = checkTwoPhaseTicks(options, cout);
+	passed = checkSnapshots(options, cout) && passed;
+	passed = checkRewind(options, cout) && passed;
+	passed = checkSavedGames(options, cout) && passed;
+	passed = checkDeathWithoutActors(options, cout) && passed;
+	return passed ? 0 : 1;
+}
+
+int main(int argc, char* argv[])
+{
+	string assetDirectory = "Assets";
+	string keys = "none";
+	long maxTicks = 1000000;
+	int numGames = 1;
+	int numThreads = 1;
+	bool seeded = false;
+	uint64_t worldSeed = 0;
+	string recordPath;
+	string replayPath;
+	long fromTick = 0;
+	string loadPath;
+	string autosavePath;
+	int decideThreads = 1;
+	int rewindTicks = 0;
+
+	if (argc > 1 && string(argv[1]) == "generate")
+		return generateLevels(argc, argv);
+	if (argc > 1 && string(argv[1]) == "check")
+		return runChecks(argc, argv);
+
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (i + 1 == argc)
+		{
+			usage();
+			return 1;
+		}
+		if (arg == "--assets")
+			assetDirectory = argv[++i];
+		else if (arg == "--keys")
+			keys = argv[++i];
+		else if (arg == "--ticks")
+			maxTicks = atol(argv[++i]);
+		else if (arg == "--games")
+			numGames = atoi(argv[++i]);
+		else if (arg == "--threads")
+			numThreads = atoi(argv[++i]);
+		else if (arg == "--seed")
+		{
+			seeded = true;
+			worldSeed = strtoull(argv[++i], nullptr, 10);
+		}
+		else if (arg == "--record")
+			recordPath = argv[++i];
+		else if (arg == "--replay")
+			replayPath = argv[++i];
+		else if (arg == "--from-tick")
+			fromTick = atol(argv[++i]);
+		else if (arg == "--load")
+			loadPath = argv[++i];
+		else if (arg == "--autosave")
+			autosavePath = argv[++i];
+		else if (arg == "--two-phase")
+			decideThreads = atoi(argv[++i]);
+		else if (arg == "--rewind")
+			rewindTicks = atoi(argv[++i]);
+		else
+		{
+			usage();
+			return 1;
+		}
+	}
+
+	string assetPath;
+	if (!findLevels(assetDirectory, assetPath))
+		return 1;
+
+	if (!replayPath.empty())
+		return playReplay(assetPath, replayPath, fromTick, maxTicks);
+	if ((!recordPath.empty() || !loadPath.empty() || !autosavePath.empty()) && numGames != 1)
+	{
+		cout << "Only a single game can be recorded, loaded or saved" << endl;
+		return 1;
+	}
+	if (!recordPath.empty() && rewindTicks > 0)
+	{
+		cout << "A rewound game can't be recorded" << endl;
+		return 1;
+	}
+
+	WorldSnapshot savedGame;
+	if (!loadPath.empty() && !readSavedGame(loadPath, savedGame))
+	{
+		cout << "Cannot read saved game " << loadPath << endl;
+		return 1;
+	}
+
+	bool randomKeys = keys.compare(0, 7, "random:") == 0;
+	unsigned int seed = 0;
+	ScriptedKeySource script;
+	if (randomKeys)
+		seed = static_cast<unsigned int>(strtoul(keys.c_str() + 7, nullptr, 10));
+	else if (keys != "none" && !script.loadScript(keys))
+	{
+		cout << "Cannot read key script " << keys << endl;
+		return 1;
+	}
+
+	vector<HeadlessResult> results(numGames);
+	BatchRunner runner(numThreads);
+	auto start = chrono::steady_clock::now();
+	runner.run(numGames, [&](int game) {
+		RandomKeySource randomKeySource(seed + game);
+		ScriptedKeySource scriptedKeySource = script;
+		KeySource* keySource = nullptr;
+		if (randomKeys)
+			keySource = &randomKeySource;
+		else if (keys != "none")
+			keySource = &scriptedKeySource;
+
+		StudentWorld* world = new StudentWorld(assetPath);
+		if (seeded)
+			world->setRandomSeed(worldSeed + game);
+		if (decideThreads > 1)
+			world->setTwoPhaseTicks(decideThreads);
+		if (rewindTicks > 0)
+			world->setRewindLength(rewindTicks);
+		ReplayRecorder recorder;
+		if (!recordPath.empty())
+		{
+			if (recorder.open(recordPath, world->getRandomSeed()))
+				world->startRecording(&recorder);
+			else
+				cerr << "Cannot write replay " << recordPath << endl;
+		}
+		if (!loadPath.empty())
+			world->loadSnapshot(savedGame);
+		if (!autosavePath.empty())
+			world->setAutosave(autosavePath, AUTOSAVE_TICKS);
+		HeadlessGame headless(world, keySource);
+		if (rewindTicks > 0)
+			headless.setDeathHandler([world, rewindTicks]() { return world->rewind(rewindTicks); });
+		results[game] = headless.play(maxTicks, !loadPath.empty());
+		delete world;
+	});
+	double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+	long totalTicks = 0;
+	for (int game = 0; game < numGames; game++)
+	{
+		reportGame(game, results[game]);
+		totalTicks += results[game].ticks;
+	}
+	reportSpeed(totalTicks, seconds, runner.getNumThreads());
+	return 0;
+}
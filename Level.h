@@ -95,6 +95,15 @@ public:
 		return m_maze[y][x];
 	}
 
+	  // Put entry at x,y, for levels made in code rather than read from a
+	  // file.  Squares off the board are ignored.
+	void setContentsOf(int x, int y, MazeEntry entry)
+	{
+		if (x < 0  ||  x >= VIEW_WIDTH  ||  y < 0  ||  y >= VIEW_HEIGHT)
+			return;
+		m_maze[y][x] = entry;
+	}
+
 private:
 
 	MazeEntry	m_maze[VIEW_HEIGHT][VIEW_WIDTH];
@@ -0,0 +1,152 @@
+#include "LevelGenerator.h"
+#include <fstream>
+using namespace std;
+
+LevelDensities LevelDensities::evenly(double density)
+{
+	double each = density / 7;
+	LevelDensities densities = { each, each, each, each, each, each, each };
+	return densities;
+}
+
+bool LevelDensities::preset(string name, LevelDensities& densities)
+{
+	  //                               walls marbles pits  robots factories crystals goodies
+	static const LevelDensities SPARSE =  { 0.05, 0.02, 0.02, 0.02, 0.01, 0.03, 0.02 };
+	static const LevelDensities TYPICAL = { 0.20, 0.05, 0.04, 0.04, 0.02, 0.06, 0.04 };
+	static const LevelDensities WALLS =   { 0.90, 0.00, 0.00, 0.01, 0.00, 0.02, 0.00 };
+	static const LevelDensities ROBOTS =  { 0.00, 0.00, 0.00, 0.60, 0.30, 0.02, 0.05 };
+	static const LevelDensities CROWDED = { 0.25, 0.15, 0.10, 0.15, 0.10, 0.15, 0.10 };
+
+	if (name == "sparse")
+		densities = SPARSE;
+	else if (name == "typical")
+		densities = TYPICAL;
+	else if (name == "walls")
+		densities = WALLS;
+	else if (name == "robots")
+		densities = ROBOTS;
+	else if (name == "crowded")
+		densities = CROWDED;
+	else
+		return false;
+	return true;
+}
+
+LevelGenerator::LevelGenerator(uint64_t seed)
+ : m_random(seed)
+{
+}
+
+Level LevelGenerator::generate(const LevelDensities& densities)
+{
+	Level lev("");
+	for (int y = 0; y < VIEW_HEIGHT; y++)
+	{
+		for (int x = 0; x < VIEW_WIDTH; x++)
+		{
+			if (x == 0 || y == 0 || x == VIEW_WIDTH - 1 || y == VIEW_HEIGHT - 1)
+				lev.setContentsOf(x, y, Level::wall);
+			else
+				lev.setContentsOf(x, y, pickEntry(densities));
+		}
+	}
+
+	  // The player and the exit go last, on two different inner squares,
+	  // over whatever was there
+	int playerX = m_random.nextInt(1, VIEW_WIDTH - 2);
+	int playerY = m_random.nextInt(1, VIEW_HEIGHT - 2);
+	int exitX;
+	int exitY;
+	do
+	{
+		exitX = m_random.nextInt(1, VIEW_WIDTH - 2);
+		exitY = m_random.nextInt(1, VIEW_HEIGHT - 2);
+	} while (exitX == playerX && exitY == playerY);
+	lev.setContentsOf(playerX, playerY, Level::player);
+	lev.setContentsOf(exitX, exitY, Level::exit);
+	return lev;
+}
+
+Level::MazeEntry LevelGenerator::pickEntry(const LevelDensities& densities)
+{
+	const double chances[] = {
+		densities.walls, densities.marbles, densities.pits, densities.rageBots,
+		densities.factories, densities.crystals, densities.goodies
+	};
+	const int NUM_CHANCES = sizeof(chances) / sizeof(chances[0]);
+	double total = 0;
+	for (int i = 0; i < NUM_CHANCES; i++)
+		total += chances[i] > 0 ? chances[i] : 0;
+	double scale = total > 1 ? total : 1;
+
+	  // One draw picks the kind of thing, or nothing
+	double draw = m_random.nextInt(0, 999999) / 1000000.0 * scale;
+	int pick = -1;
+	for (int i = 0; i < NUM_CHANCES && pick < 0; i++)
+	{
+		if (chances[i] <= 0)
+			continue;
+		if (draw < chances[i])
+			pick = i;
+		else
+			draw -= chances[i];
+	}
+
+	switch (pick)
+	{
+	  case 0:
+		return Level::wall;
+	  case 1:
+		return Level::marble;
+	  case 2:
+		return Level::pit;
+	  case 3:
+		return m_random.nextInt(0, 1) == 0 ? Level::horiz_ragebot : Level::vert_ragebot;
+	  case 4:
+		return m_random.nextInt(0, 1) == 0 ? Level::thiefbot_factory : Level::mean_thiefbot_factory;
+	  case 5:
+		return Level::crystal;
+	  case 6:
+	  {
+		static const Level::MazeEntry GOODIES[] = { Level::restore_health, Level::extra_life, Level::ammo };
+		return GOODIES[m_random.nextInt(0, 2)];
+	  }
+	}
+	return Level::empty;
+}
+
+bool LevelGenerator::writeLevel(string path, const Level& lev)
+{
+	ofstream out(path);
+	if (!out)
+		return false;
+
+	  // The top row of the board is the first line of the file
+	for (int y = VIEW_HEIGHT - 1; y >= 0; y--)
+	{
+		string line(VIEW_WIDTH, ' ');
+		for (int x = 0; x < VIEW_WIDTH; x++)
+		{
+			switch (lev.getContentsOf(x, y))
+			{
+			  case Level::empty:                 line[x] = ' '; break;
+			  case Level::exit:                  line[x] = 'x'; break;
+			  case Level::player:                line[x] = '@'; break;
+			  case Level::horiz_ragebot:         line[x] = 'h'; break;
+			  case Level::vert_ragebot:          line[x] = 'v'; break;
+			  case Level::thiefbot_factory:      line[x] = '1'; break;
+			  case Level::mean_thiefbot_factory: line[x] = '2'; break;
+			  case Level::wall:                  line[x] = '#'; break;
+			  case Level::marble:                line[x] = 'b'; break;
+			  case Level::pit:                   line[x] = 'o'; break;
+			  case Level::crystal:               line[x] = '*'; break;
+			  case Level::restore_health:        line[x] = 'r'; break;
+			  case Level::extra_life:            line[x] = 'e'; break;
+			  case Level::ammo:                  line[x] = 'a'; break;
+			}
+		}
+		out << line << '\n';
+	}
+	return static_cast<bool>(out);
+}
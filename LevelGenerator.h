@@ -0,0 +1,55 @@
+#ifndef LEVELGENERATOR_H_
+#define LEVELGENERATOR_H_
+
+#include "Level.h"
+#include "RandomGenerator.h"
+#include <cstdint>
+#include <string>
+
+// Makes random levels for load tests and benchmarks: walls all around the
+// edge, one player and one exit, and each inner square filled by chance
+// according to a set of densities.  The same seed and densities always
+// make the same levels.
+
+  // The chance that an inner square holds each kind of thing.  RageBots
+  // are horizontal or vertical, factories regular or mean, and goodies
+  // any of the three, at even odds.  If the chances add up to more than
+  // 1, they are scaled down to add up to 1.
+struct LevelDensities
+{
+	double walls;
+	double marbles;
+	double pits;
+	double rageBots;
+	double factories;
+	double crystals;
+	double goodies;
+
+	  // density spread evenly over every kind of thing
+	static LevelDensities evenly(double density);
+
+	  // Named sets of densities: "sparse", "typical", "walls" (walls nearly
+	  // everywhere), "robots" (a board saturated with RageBots and
+	  // factories) and "crowded" (every square filled).  Return false,
+	  // leaving densities alone, if name is none of these.
+	static bool preset(std::string name, LevelDensities& densities);
+};
+
+class LevelGenerator
+{
+public:
+	LevelGenerator(uint64_t seed);
+
+	  // Make the next level
+	Level generate(const LevelDensities& densities);
+
+	  // Write lev to path in the text format Level::loadLevel reads
+	static bool writeLevel(std::string path, const Level& lev);
+
+private:
+	RandomGenerator m_random;
+
+	Level::MazeEntry pickEntry(const LevelDensities& densities);
+};
+
+#endif // LEVELGENERATOR_H_
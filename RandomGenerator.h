@@ -0,0 +1,88 @@
+#ifndef RANDOMGENERATOR_H_
+#define RANDOMGENERATOR_H_
+
+#include <cstdint>
+
+// A small, fast pseudo-random generator (xoshiro256**) with 256 bits of
+// state.  Each world has its own, so worlds never contend for one, and a
+// world seeded the same way plays the same way given the same keys.
+
+class RandomGenerator
+{
+public:
+	RandomGenerator(uint64_t seed = 0)
+	{
+		setSeed(seed);
+	}
+
+	  // Start the sequence that seed picks out.  The state is filled from
+	  // the seed with splitmix64, which never leaves it all zero.
+	void setSeed(uint64_t seed)
+	{
+		for (int i = 0; i < 4; i++)
+		{
+			seed += 0x9e3779b97f4a7c15ULL;
+			uint64_t z = seed;
+			z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+			z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+			m_state[i] = z ^ (z >> 31);
+		}
+	}
+
+	uint64_t next()
+	{
+		uint64_t result = rotateLeft(m_state[1] * 5, 7) * 9;
+		uint64_t t = m_state[1] << 17;
+		m_state[2] ^= m_state[0];
+		m_state[3] ^= m_state[1];
+		m_state[1] ^= m_state[2];
+		m_state[0] ^= m_state[3];
+		m_state[2] ^= t;
+		m_state[3] = rotateLeft(m_state[3], 45);
+		return result;
+	}
+
+	  // Return a uniformly distributed random int from min to max, inclusive
+	int nextInt(int min, int max)
+	{
+		if (max < min)
+		{
+			int temp = min;
+			min = max;
+			max = temp;
+		}
+		uint64_t range = uint64_t(int64_t(max) - min) + 1;
+		  // Reject the few values at the bottom that would make some
+		  // results come up once more often than others
+		uint64_t threshold = (0 - range) % range;
+		uint64_t r;
+		do
+			r = next();
+		while (r < threshold);
+		return int(int64_t(min) + int64_t(r % range));
+	}
+
+	  // The whole state, for saving a world and restoring it exactly
+	static const int STATE_WORDS = 4;
+	void getState(uint64_t state[STATE_WORDS]) const
+	{
+		for (int i = 0; i < STATE_WORDS; i++)
+			state[i] = m_state[i];
+	}
+
+	void setState(const uint64_t state[STATE_WORDS])
+	{
+		for (int i = 0; i < STATE_WORDS; i++)
+			m_state[i] = state[i];
+	}
+
+private:
+	uint64_t m_state[STATE_WORDS];
+
+	static uint64_t rotateLeft(uint64_t x, int k)
+	{
+		return (x << k) | (x >> (64 - k));
+	}
+};
+
+#endif // RANDOMGENERATOR_H_
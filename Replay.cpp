@@ -0,0 +1,229 @@
+#include "Replay.h"
+#include <iterator>
+using namespace std;
+
+namespace
+{
+	const char MAGIC[4] = { 'M', 'M', 'R', 'P' };
+	const unsigned char VERSION = 2;
+
+	  // What a record is, in the low bits of its header
+	const int KEY_EVENT = 0;
+	const int LEVEL_START = 1;
+	const int LEVEL_UNDER_WAY = 2;
+	const int NUM_RECORD_KINDS = 4;
+
+	  // Reads the records of a replay from a buffer holding the whole file
+	class ReplayReader
+	{
+	public:
+		ReplayReader(const vector<char>& data)
+		 : m_data(data), m_pos(0), m_failed(false)
+		{
+		}
+
+		bool atEnd() const
+		{
+			return m_pos >= m_data.size();
+		}
+
+		bool failed() const
+		{
+			return m_failed;
+		}
+
+		unsigned char readByte()
+		{
+			if (atEnd())
+			{
+				m_failed = true;
+				return 0;
+			}
+			return static_cast<unsigned char>(m_data[m_pos++]);
+		}
+
+		uint64_t readVarint()
+		{
+			uint64_t value = 0;
+			for (int shift = 0; shift < 64; shift += 7)
+			{
+				unsigned char byte = readByte();
+				value |= uint64_t(byte & 0x7f) << shift;
+				if ((byte & 0x80) == 0)
+					return value;
+			}
+			m_failed = true;
+			return 0;
+		}
+
+		  // Set bytes to the next numBytes bytes
+		void readBytes(size_t numBytes, vector<char>& bytes)
+		{
+			if (numBytes > m_data.size() - m_pos)
+			{
+				m_failed = true;
+				m_pos = m_data.size();
+				return;
+			}
+			bytes.assign(m_data.begin() + m_pos, m_data.begin() + m_pos + numBytes);
+			m_pos += numBytes;
+		}
+
+		uint64_t readWord()
+		{
+			uint64_t value = 0;
+			for (int i = 0; i < 8; i++)
+				value |= uint64_t(readByte()) << (8 * i);
+			return value;
+		}
+
+	private:
+		const vector<char>& m_data;
+		size_t m_pos;
+		bool m_failed;
+	};
+}
+
+ReplayRecorder::ReplayRecorder()
+ : m_lastTick(0)
+{
+}
+
+ReplayRecorder::~ReplayRecorder()
+{
+	m_out.flush();
+}
+
+bool ReplayRecorder::open(string path, uint64_t seed)
+{
+	m_out.open(path, ios::binary | ios::trunc);
+	if (!m_out)
+		return false;
+	m_out.write(MAGIC, sizeof(MAGIC));
+	m_out.put(static_cast<char>(VERSION));
+	writeWord(seed);
+	m_lastTick = 0;
+	return static_cast<bool>(m_out);
+}
+
+void ReplayRecorder::keyPressed(long tick, int key)
+{
+	if (!m_out.is_open())
+		return;
+	writeVarint(uint64_t(tick - m_lastTick) * NUM_RECORD_KINDS + KEY_EVENT);
+	writeVarint(static_cast<uint64_t>(key));
+	m_lastTick = tick;
+}
+
+void ReplayRecorder::levelStarted(const ReplayKeyframe& keyframe)
+{
+	writeKeyframe(keyframe, LEVEL_START);
+}
+
+void ReplayRecorder::levelUnderWay(const ReplayKeyframe& keyframe)
+{
+	writeKeyframe(keyframe, LEVEL_UNDER_WAY);
+}
+
+void ReplayRecorder::writeKeyframe(const ReplayKeyframe& keyframe, int kind)
+{
+	if (!m_out.is_open())
+		return;
+	writeVarint(uint64_t(keyframe.tick - m_lastTick) * NUM_RECORD_KINDS + kind);
+	writeVarint(static_cast<uint64_t>(keyframe.level));
+	writeVarint(static_cast<uint64_t>(keyframe.score));
+	writeVarint(static_cast<uint64_t>(keyframe.lives));
+	for (int i = 0; i < RandomGenerator::STATE_WORDS; i++)
+		writeWord(keyframe.randomState[i]);
+	if (kind == LEVEL_UNDER_WAY)
+	{
+		writeVarint(keyframe.world.size());
+		m_out.write(keyframe.world.data(), keyframe.world.size());
+	}
+	m_lastTick = keyframe.tick;
+	m_out.flush();
+}
+
+void ReplayRecorder::writeVarint(uint64_t value)
+{
+	while (value >= 0x80)
+	{
+		m_out.put(static_cast<char>((value & 0x7f) | 0x80));
+		value >>= 7;
+	}
+	m_out.put(static_cast<char>(value));
+}
+
+void ReplayRecorder::writeWord(uint64_t value)
+{
+	for (int i = 0; i < 8; i++)
+		m_out.put(static_cast<char>((value >> (8 * i)) & 0xff));
+}
+
+Replay::Replay()
+ : m_seed(0)
+{
+}
+
+bool Replay::load(string path)
+{
+	ifstream in(path, ios::binary);
+	if (!in)
+		return false;
+	vector<char> data((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+	ReplayReader reader(data);
+	for (size_t i = 0; i < sizeof(MAGIC); i++)
+	{
+		if (reader.readByte() != static_cast<unsigned char>(MAGIC[i]))
+			return false;
+	}
+	if (reader.readByte() != VERSION)
+		return false;
+	m_seed = reader.readWord();
+
+	m_keyEvents.clear();
+	m_keyframes.clear();
+	long tick = 0;
+	while (!reader.atEnd() && !reader.failed())
+	{
+		uint64_t header = reader.readVarint();
+		tick += static_cast<long>(header / NUM_RECORD_KINDS);
+		int kind = static_cast<int>(header % NUM_RECORD_KINDS);
+		if (kind == KEY_EVENT)
+		{
+			ReplayKeyEvent event;
+			event.tick = tick;
+			event.key = static_cast<int>(reader.readVarint());
+			if (!reader.failed())
+				m_keyEvents.push_back(event);
+		}
+		else if (kind == LEVEL_START || kind == LEVEL_UNDER_WAY)
+		{
+			ReplayKeyframe keyframe;
+			keyframe.tick = tick;
+			keyframe.level = static_cast<int>(reader.readVarint());
+			keyframe.score = static_cast<int>(reader.readVarint());
+			keyframe.lives = static_cast<int>(reader.readVarint());
+			for (int i = 0; i < RandomGenerator::STATE_WORDS; i++)
+				keyframe.randomState[i] = reader.readWord();
+			if (kind == LEVEL_UNDER_WAY)
+				reader.readBytes(static_cast<size_t>(reader.readVarint()), keyframe.world);
+			if (!reader.failed())
+				m_keyframes.push_back(keyframe);
+		}
+		else  // not a record this version writes: the rest is garbage
+			break;
+	}
+	  // A recording cut off mid-record (say, by a crash) is still good up
+	  // to the last whole record
+	return !m_keyframes.empty();
+}
+
+int Replay::findKeyframe(long tick) const
+{
+	int found = -1;
+	for (size_t i = 0; i < m_keyframes.size() && m_keyframes[i].tick <= tick; i++)
+		found = static_cast<int>(i);
+	return found;
+}
@@ -0,0 +1,101 @@
+#ifndef REPLAY_H_
+#define REPLAY_H_
+
+#include "RandomGenerator.h"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// A recording of a game: the keys the player pressed and the tick each
+// was pressed on, plus a keyframe whenever a level starts (or restarts
+// after the player dies) and every so many ticks within a level.  A level
+// start is fully determined by the level number, score, lives and the
+// world's random state; a keyframe within a level holds the whole world
+// as a saved game.  Either way a replay can be played from any keyframe,
+// not just the beginning.
+//
+// File layout, all integers little-endian or unsigned LEB128 varints:
+//   "MMRP", version byte, 8-byte seed
+//   records, each starting with varint (ticks since last record * 4 + k):
+//     k = 0: a key event, followed by varint key
+//     k = 1: a level start, followed by varints level, score, lives and
+//            the random state as four 8-byte words
+//     k = 2: a keyframe within a level: the same as a level start, then
+//            a varint byte count and the saved game (see encodeSavedGame)
+// Ticks count calls to StudentWorld::move since the session started,
+// from 1; a keyframe's tick is the number of moves before it was taken.
+
+struct ReplayKeyEvent
+{
+	long tick;
+	int key;
+};
+
+struct ReplayKeyframe
+{
+	long tick;
+	int level;
+	int score;
+	int lives;
+	uint64_t randomState[RandomGenerator::STATE_WORDS];
+	std::vector<char> world;    // within a level, the world as a saved game
+};
+
+  // Writes a replay as the game is played.  Everything up to the latest
+  // keyframe is on disk even if the game never ends cleanly.
+class ReplayRecorder
+{
+public:
+	ReplayRecorder();
+	~ReplayRecorder();
+	bool open(std::string path, uint64_t seed);
+	void keyPressed(long tick, int key);
+	void levelStarted(const ReplayKeyframe& keyframe);
+	void levelUnderWay(const ReplayKeyframe& keyframe);
+
+private:
+	std::ofstream m_out;
+	long m_lastTick;
+
+	void writeVarint(uint64_t value);
+	void writeWord(uint64_t value);
+	void writeKeyframe(const ReplayKeyframe& keyframe, int kind);
+
+	  // Prevent copying or assigning ReplayRecorders
+	ReplayRecorder(const ReplayRecorder&);
+	ReplayRecorder& operator=(const ReplayRecorder&);
+};
+
+class Replay
+{
+public:
+	Replay();
+	bool load(std::string path);
+
+	uint64_t getSeed() const
+	{
+		return m_seed;
+	}
+
+	const std::vector<ReplayKeyEvent>& getKeyEvents() const
+	{
+		return m_keyEvents;
+	}
+
+	const std::vector<ReplayKeyframe>& getKeyframes() const
+	{
+		return m_keyframes;
+	}
+
+	  // Index of the last keyframe at or before tick, or -1 if there are
+	  // no keyframes that early
+	int findKeyframe(long tick) const;
+
+private:
+	uint64_t m_seed;
+	std::vector<ReplayKeyEvent> m_keyEvents;
+	std::vector<ReplayKeyframe> m_keyframes;
+};
+
+#endif // REPLAY_H_
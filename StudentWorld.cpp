@@ -2,13 +2,28 @@
 #include "GameConstants.h"
 #include "Level.h"
 #include "Actor.h"
+#include "Replay.h"
 #include <string>
 #include <iostream>
 #include <iomanip>
 #include <sstream>
+#include <algorithm>
+#include <random>
 
 using namespace std;
 
+// How far from its own square an actor's decision can look, other than
+// along its line of fire: the square ahead, or a factory's census area.
+static const int DECISION_REACH = 3;
+
+// Fewest actors worth handing to a thread of their own to decide.  Waking
+// a worker takes a few microseconds, about as long as this many decisions.
+static const int MIN_DECISIONS_PER_THREAD = 16;
+
+// Ticks between the keyframes a replay gets within a level, so playback can
+// start near any tick: 5 s of play at the usual speed
+static const int REPLAY_KEYFRAME_TICKS = 500;
+
 GameWorld* createStudentWorld(string assetPath)
 {
 	return new StudentWorld(assetPath);
@@ -17,16 +32,32 @@ GameWorld* createStudentWorld(string assetPath)
 // Students:  Add code to this file, StudentWorld.h, Actor.h, and Actor.cpp
 
 StudentWorld::StudentWorld(string assetPath)
-: GameWorld(assetPath), m_bonusScore(1000), m_player(nullptr), m_amtCrystalsLeft(0), m_gameStatus(0)
+: GameWorld(assetPath), m_recorder(nullptr), m_sessionTick(0), m_autosaveTicks(0), m_currentTick(1), m_takingTurns(false),
+  m_nextSpawnOrder(0), m_clearShotsValid(false), m_player(nullptr), m_bonusScore(1000), m_amtCrystalsLeft(0),
+  m_gameStatus(0), m_decideThreads(1), m_minDecisionsPerThread(MIN_DECISIONS_PER_THREAD), m_decidePool(nullptr),
+  m_clearShotsEpoch(0), m_clearShotsEpochAtDecide(0)
 {
+	clearSquares();
+	std::random_device rd;
+	setRandomSeed((uint64_t(rd()) << 32) | rd());
 }
 
 StudentWorld::~StudentWorld() {
     cleanUp();
+	delete m_decidePool;
+#ifdef PROFILE_TICKS
+	m_profiler.addToProcessTotals();
+#endif
 }
 
 int StudentWorld::init()
 {
+	if (m_recorder != nullptr) {
+		ReplayKeyframe keyframe;
+		makeKeyframe(keyframe);
+		m_recorder->levelStarted(keyframe);
+	}
+
     //check valid level
 	std::ostringstream oss;
 	oss.fill('0');
@@ -36,131 +67,313 @@ int StudentWorld::init()
 	if (loadLevelResult == Level::load_fail_file_not_found || getLevel() > 99) return GWSTATUS_PLAYER_WON;
 	if (loadLevelResult == Level::load_fail_bad_format) return GWSTATUS_PLAYER_WON;
     m_bonusScore = 1000;
+	keepRewindPoint();
     return GWSTATUS_CONTINUE_GAME;
 }
 
 int StudentWorld::move()
 {
+	PROFILE_TICK_SECTION(m_profiler, TickProfiler::TICK);
 	m_gameStatus = GWSTATUS_CONTINUE_GAME;
+	m_sessionTick++;
     //UPDATE GAME TEXT
-    string formattedText = formatInfo(getScore(), getLevel(), getLives(), m_player->getHealthPct(), m_player->getAmmo(), m_bonusScore);
+	{
+		PROFILE_TICK_SECTION(m_profiler, TickProfiler::FORMAT_HUD);
+		string formattedText = formatInfo(getScore(), getLevel(), getLives(), m_player->getHealthPct(), m_player->getAmmo(), m_bonusScore);
 
-    setGameStatText(formattedText);
+		setGameStatText(formattedText);
+	}
+
+	// A level without crystals has its exit open from the start
+	if (m_currentTick == 1 && !anyCrystals()) notifyAllCrystalsCollected();
 
     //ALL ACTORS DO SOMETHING IF NOT DEAD
 
-	for (list<Actor*>::iterator itr = m_actorList.begin(); itr != m_actorList.end(); itr++) {
-		(*itr)->doSomething();
-		if (!m_player->isAlive()) { 
-			decLives();
-			while (decCrystals());
-			return GWSTATUS_PLAYER_DIED;
-		}
+	if (!takeTurns()) {
+		decLives();
+		return GWSTATUS_PLAYER_DIED;
+	}
+	{
+		PROFILE_TICK_SECTION(m_profiler, IID_PLAYER);
+		m_player->doSomething();
 	}
-	m_player->doSomething();
 
     //REMOVE DEAD ACTORS 
-	destroyActorsIfDeadHelper();
+	{
+		PROFILE_TICK_SECTION(m_profiler, TickProfiler::DESTROY_DEAD);
+		destroyActorsIfDeadHelper();
+	}
 
     //REDUCE BONUS BY ONE
     if (m_bonusScore > 0) {
         m_bonusScore--;
     }
 
+	m_currentTick++;
+	keepRewindPoint();
+	if (m_gameStatus == GWSTATUS_CONTINUE_GAME && m_sessionTick % REPLAY_KEYFRAME_TICKS == 0) recordLevelUnderWay();
+	if (m_autosaveTicks > 0 && m_sessionTick % m_autosaveTicks == 0) saveGame(m_autosavePath);
 
 	return m_gameStatus;
 }
 
+bool StudentWorld::takeTurns() {
+	// Actors take their turns in spawn order, as they come in
+	// m_actorList: every actor that acts each tick, and every robot due
+	// on this one.  Marbles never act, and pits, pickups and exits only
+	// react when something lands on their square.
+	// A player who died during their own turn last tick is found before
+	// anyone else acts
+	if (!m_player->isAlive()) return false;
+	{
+		PROFILE_TICK_SECTION(m_profiler, TickProfiler::TURN_ORDER);
+		// Both lists are in spawn order, so one pass merges them
+		takeDueRobots();
+		m_turnOrder.resize(m_activeActors.size() + m_dueRobots.size());
+		merge(m_activeActors.begin(), m_activeActors.end(), m_dueRobots.begin(), m_dueRobots.end(), m_turnOrder.begin(),
+			[](const Actor* a, const Actor* b) { return a->getSpawnOrder() < b->getSpawnOrder(); });
+	}
+
+	if (m_decideThreads > 1) decideAll(m_turnOrder);
+	// Index rather than iterate: a pea fired during the tick joins the
+	// end of the turn order and flies on the tick it is fired
+	m_takingTurns = true;
+	bool playerSurvived = true;
+	for (size_t i = 0; i < m_turnOrder.size() && playerSurvived; i++) {
+		Actor* a = m_turnOrder[i];
+		if (a->hasCapability(Actor::SCHEDULED)) {
+			Robot* r = static_cast<Robot*>(a);
+			scheduleRobot(r, m_currentTick + r->getRestTicks());
+		}
+		{
+			PROFILE_TICK_SECTION(m_profiler, a->getKind());
+			if (m_decideThreads > 1 && i < m_intents.size()) actOnDecision(a, m_intents[i]);
+			else a->doSomething();
+		}
+		playerSurvived = m_player->isAlive();
+	}
+	m_takingTurns = false;
+	return playerSurvived;
+}
+
+void StudentWorld::takeDueRobots() {
+	// Take the robots due now out of this tick's slot, leaving any filed
+	// here for a later lap of the wheel.  A slot is filled in the order
+	// robots finish their turns, which is not always spawn order, so sort
+	// the few that are due.
+	vector<Robot*>& slot = m_robotWheel[m_currentTick % ROBOT_WHEEL_SIZE];
+	m_dueRobots.clear();
+	size_t numWaiting = 0;
+	for (size_t i = 0; i < slot.size(); i++) {
+		if (slot[i]->getNextActiveTick() == m_currentTick) m_dueRobots.push_back(slot[i]);
+		else slot[numWaiting++] = slot[i];
+	}
+	slot.resize(numWaiting);
+	sort(m_dueRobots.begin(), m_dueRobots.end(), [](const Robot* a, const Robot* b) {
+		return a->getSpawnOrder() < b->getSpawnOrder();
+	});
+}
+
+void StudentWorld::setTwoPhaseTicks(int numThreads) {
+	setTwoPhaseTicks(numThreads, MIN_DECISIONS_PER_THREAD);
+}
+
+void StudentWorld::setTwoPhaseTicks(int numThreads, int minDecisionsPerThread) {
+	m_decideThreads = numThreads;
+	m_minDecisionsPerThread = max(minDecisionsPerThread, 1);
+	delete m_decidePool;
+	m_decidePool = nullptr;
+	if (numThreads > 1) m_decidePool = new BatchRunner(numThreads);
+}
+
+template<typename ActorType>
+void StudentWorld::decideAll(const vector<ActorType*>& actors) {
+	// Deciding only reads the world, but the clear shot table is built on
+	// first use, so build it now rather than from several threads at once
+	if (!m_clearShotsValid) updateClearShots();
+	m_clearShotsEpochAtDecide = m_clearShotsEpoch;
+	m_changedSquares.clear();
+
+	m_intents.assign(actors.size(), ActorIntent());
+	size_t numStretches = min((size_t)m_decideThreads, actors.size() / m_minDecisionsPerThread);
+	if (numStretches <= 1) {
+		for (size_t i = 0; i < actors.size(); i++)
+			actors[i]->decide(m_intents[i]);
+		return;
+	}
+
+	// Each job decides for one contiguous stretch of actors and writes
+	// only those actors' intents
+	size_t perStretch = (actors.size() + numStretches - 1) / numStretches;
+	m_decidePool->run(static_cast<int>(numStretches), [&](int stretch) {
+		size_t begin = min(stretch * perStretch, actors.size());
+		size_t end = min(begin + perStretch, actors.size());
+		for (size_t i = begin; i < end; i++)
+			actors[i]->decide(m_intents[i]);
+	});
+}
+
+void StudentWorld::actOnDecision(Actor* a, ActorIntent& intent) {
+	// Actors that acted earlier in the group may have changed what this
+	// one would see; if so, its decision is out of date
+	if (m_clearShotsEpoch != m_clearShotsEpochAtDecide || changedNear(a->getX(), a->getY())) {
+		intent = ActorIntent();
+		a->decide(intent);
+	}
+	a->act(intent);
+}
+
+bool StudentWorld::changedNear(int x, int y) const {
+	if (!m_changedSquares.any()) return false;
+	for (int nearY = y - DECISION_REACH; nearY <= y + DECISION_REACH; nearY++) {
+		for (int nearX = x - DECISION_REACH; nearX <= x + DECISION_REACH; nearX++) {
+			if (m_changedSquares.test(nearX, nearY)) return true;
+		}
+	}
+	return false;
+}
+
+void StudentWorld::scheduleRobot(Robot* r, int tick) {
+	r->setNextActiveTick(tick);
+	m_robotWheel[tick % ROBOT_WHEEL_SIZE].push_back(r);
+}
+
+void StudentWorld::unscheduleRobot(Robot* r) {
+	vector<Robot*>& slot = m_robotWheel[r->getNextActiveTick() % ROBOT_WHEEL_SIZE];
+	for (vector<Robot*>::iterator itr = slot.begin(); itr != slot.end(); itr++) {
+		if ((*itr) == r) {
+			slot.erase(itr);
+			return;
+		}
+	}
+}
+
 void StudentWorld::cleanUp()
 {	
-	for (list<Actor*>::iterator itr = m_actorList.begin(); itr != m_actorList.end(); ) {
-		delete (*itr);
-		(*itr) = nullptr;
-		itr = m_actorList.erase(itr);
+	for (size_t i = 0; i < m_actorList.size(); i++) {
+		m_actorList[i]->~Actor();
 	}
-    delete m_player;
+	m_actorList.clear();
+	m_activeActors.clear();
+	for (int slot = 0; slot < ROBOT_WHEEL_SIZE; slot++)
+		m_robotWheel[slot].clear();
+	m_crystalWatchers.clear();
+	m_amtCrystalsLeft = 0;
+	clearSquares();
+	if (m_player != nullptr) m_player->~Player();
 	m_player = nullptr;
+	// Every actor of the level has been destroyed, so all of its memory
+	// can be handed back at once
+	m_arena.releaseAll();
 }
 
-bool StudentWorld::canAgentMoveTo(Agent* agent, double x, double y, int dx, int dy) const {
-	list<Actor*> actorsAtPosition;
-	double newX, newY;
-	newX = x + dx;
-	newY = y + dy;
-	if (getActorsAtPosition(newX, newY, actorsAtPosition)){
-		for (list<Actor*>::iterator itr = actorsAtPosition.begin(); itr != actorsAtPosition.end(); itr++) {
-			newX += dx;
-			newY += dy;
-			if (agent->canPushMarbles() && (*itr)->bePushedBy(agent, (int)newX, (int)newY)) {
-				return true;
-			}
-			if ((*itr) != nullptr && !(*itr)->allowsAgentColocation()) return false;
+bool StudentWorld::canAgentMoveTo(Agent* agent, int x, int y, int dx, int dy) const {
+	int newX = x + dx;
+	int newY = y + dy;
+	if (isOpenToRobots(newX, newY)) return true;
+	// Something is in the way; only the player might still get through by
+	// pushing a marble
+	if (!agent->canPushMarbles() || m_walls.test(newX, newY)) return false;
+
+	int pushX = newX;
+	int pushY = newY;
+	bool canMove = true;
+	forEachActorAt(newX, newY, [&](Actor* a) {
+		pushX += dx;
+		pushY += dy;
+		if (a->bePushedBy(agent, pushX, pushY)) return true;
+		if (!a->allowsAgentColocation()) {
+			canMove = false;
+			return true;
 		}
-	}
-	return true;
+		return false;
+	});
+	return canMove;
 }
 
 bool StudentWorld::canMarbleMoveTo(int x, int y) const {
-	list<Actor*> actorsAtPosition;
-	if (getActorsAtPosition(x, y, actorsAtPosition)) {
-		for (list<Actor*>::iterator itr = actorsAtPosition.begin(); itr != actorsAtPosition.end(); itr++) {
-			if ((*itr) != nullptr && !(*itr)->allowsMarble()) return false;
-		}
-	}
-	return true;
+	return !m_marbleBlockers.test(x, y) && !m_playerSquare.test(x, y);
+}
+
+bool StudentWorld::isOpenToRobots(int x, int y) const {
+	return !m_agentBlockers.test(x, y) && !m_playerSquare.test(x, y);
+}
+
+bool StudentWorld::wouldStopPea(int x, int y) const {
+	return m_peaBlockers.test(x, y) || m_damageables.test(x, y) || m_playerSquare.test(x, y);
 }
 
 bool StudentWorld::swallowSwallowable(Actor* a) {
 	bool swallowedOnThisTick = false;
-	double pitX = a->getX();
-	double pitY = a->getY();
+	int pitX = a->getX();
+	int pitY = a->getY();
+	if (!isInBounds(pitX, pitY)) return false;
+	const vector<Actor*>& cell = m_cells[pitY][pitX];
 
-	for (list<Actor*>::iterator itr = m_actorList.begin(); itr != m_actorList.end(); itr++) {
-		if ((*itr)->isSwallowable() && (*itr)->getX() == pitX && (*itr)->getY() == pitY) {
+	for (vector<Actor*>::const_iterator itr = cell.begin(); itr != cell.end(); itr++) {
+		if ((*itr)->isSwallowable()) {
 			swallowedOnThisTick = true;
 			break;
 		}
 	}
 	if (!swallowedOnThisTick) return false;
 
-	for (list<Actor*>::iterator itr = m_actorList.begin(); itr != m_actorList.end(); itr++) {
-		if ((*itr)->getX() == pitX && (*itr)->getY() == pitY) {
-			(*itr)->setDead();
-		}
+	for (vector<Actor*>::const_iterator itr = cell.begin(); itr != cell.end(); itr++) {
+		(*itr)->setDead();
 	}
 	return true;
 }
 
 bool StudentWorld::existsClearShotToPlayer(int x, int y, int dx, int dy) const {
-	double newX = (double)x + dx;
-	double newY = (double)y + dy;
-	if (isPlayerAtPosition(newX, newY)) return true;
-	list<Actor*> actorsAtPosition;
-	if (getActorsAtPosition(newX, newY, actorsAtPosition)) {
-		for (list<Actor*>::iterator itr = actorsAtPosition.begin(); itr != actorsAtPosition.end(); itr++) {
-			if ((*itr)->stopsPea() || (*itr)->isDamageable()) {
-				return false;
-			}
+	int dir;
+	if (dx > 0) dir = 0;
+	else if (dx < 0) dir = 1;
+	else if (dy > 0) dir = 2;
+	else if (dy < 0) dir = 3;
+	else return false;
+	if (!m_clearShotsValid) updateClearShots();
+	return m_clearShotsFrom[dir].test(x, y);
+}
+
+void StudentWorld::updateClearShots() const {
+	static const int DX[4] = { 1, -1, 0, 0 };
+	static const int DY[4] = { 0, 0, 1, -1 };
+	Bitboard obstructions = m_peaBlockers | m_damageables;
+	for (int dir = 0; dir < 4; dir++) {
+		m_clearShotsFrom[dir].clear();
+		if (m_player == nullptr) continue;
+		// Walk away from the player against the direction of fire.  A
+		// shooter's own square doesn't block its shot, so mark a square
+		// before checking whether it blocks the squares beyond it.
+		int x = m_player->getX() - DX[dir];
+		int y = m_player->getY() - DY[dir];
+		while (isInBounds(x, y)) {
+			m_clearShotsFrom[dir].set(x, y);
+			if (obstructions.test(x, y)) break;
+			x -= DX[dir];
+			y -= DY[dir];
 		}
 	}
-	return existsClearShotToPlayer(x + dx, y + dy, dx, dy);
+	m_clearShotsValid = true;
 }
 
-bool StudentWorld::doFactoryCensus(int x, int y, int distance, int& count) const {
-	for (list<Actor*>::const_iterator itr = m_actorList.begin(); itr != m_actorList.end(); itr++) {
-		double actorX = (*itr)->getX();
-		double actorY = (*itr)->getY();
-		bool actorCountsInCensus = (*itr)->countsInFactoryCensus();
-
-		int xDistance = findDistanceHelper(x, (int)actorX);
-		int yDistance = findDistanceHelper(y, (int)actorY);
+void StudentWorld::invalidateClearShotsThrough(int x, int y) {
+	if (m_player == nullptr || m_player->getX() == x || m_player->getY() == y) {
+		m_clearShotsValid = false;
+		m_clearShotsEpoch++;
+	}
+}
 
-		if (actorCountsInCensus && xDistance == 0 && yDistance == 0) {
-			return false;
-		}
-		
-		if (actorCountsInCensus && xDistance <= distance && yDistance <= distance) { 
-			count++;
+bool StudentWorld::doFactoryCensus(int x, int y, int distance, int& count) const {
+	if (isInBounds(x, y) && m_squareCounts[y][x].censusActors > 0) return false;
+
+	// The per-square counts are kept up to date as actors come, go and
+	// move, so this only looks at the squares around the factory.
+	for (int censusY = y - distance; censusY <= y + distance; censusY++) {
+		for (int censusX = x - distance; censusX <= x + distance; censusX++) {
+			if (isInBounds(censusX, censusY)) {
+				count += m_squareCounts[censusY][censusX].censusActors;
+			}
 		}
 	}
 	return true;
@@ -174,19 +387,22 @@ int StudentWorld::findDistanceHelper(int val1, int val2) const {
 }
 
 Actor* StudentWorld::getColocatedStealable(int x, int y) const {
-	list<Actor*> actorsAtPosition;
-	if (getActorsAtPosition(x, y, actorsAtPosition)) {
-		for (list<Actor*>::iterator itr = actorsAtPosition.begin(); itr != actorsAtPosition.end(); itr++) {
-			if ((*itr)->isStealable()) return (*itr);
-		}
-	}
-	return nullptr;
+	Actor* stealable = nullptr;
+	forEachActorAt(x, y, [&](Actor* a) {
+		if (a->isStealable()) stealable = a;
+		return stealable != nullptr;
+	});
+	return stealable;
 }
 
 bool StudentWorld::damageSomething(Actor* a, int damageAmt) {
-	double peaX = a->getX();
-	double peaY = a->getY();
-	list<Actor*> actorsAtPosition;
+	int peaX = a->getX();
+	int peaY = a->getY();
+	if (!wouldStopPea(peaX, peaY)) return false;
+	if (m_walls.test(peaX, peaY)) {
+		a->setDead();
+		return true;
+	}
 	bool damagedSomething = false;
 
 	if (isPlayerColocatedWith(a)) {
@@ -194,33 +410,49 @@ bool StudentWorld::damageSomething(Actor* a, int damageAmt) {
 		a->setDead();
 		damagedSomething = true;
 	}
-	if (getActorsAtPosition(peaX, peaY, actorsAtPosition)) {
-		for (list<Actor*>::iterator itr = actorsAtPosition.begin(); itr != actorsAtPosition.end(); itr++) {
-			if ((*itr)->isDamageable()) {
-				(*itr)->damage(damageAmt);
-				a->setDead();
-				damagedSomething = true;
-			}
-			if ((*itr)->stopsPea()) {
-				a->setDead();
-				damagedSomething = true;
-			}
+	forEachActorAt(peaX, peaY, [&](Actor* other) {
+		if (other->isDamageable()) {
+			other->damage(damageAmt);
+			a->setDead();
+			damagedSomething = true;
 		}
-	}
+		if (other->stopsPea()) {
+			a->setDead();
+			damagedSomething = true;
+		}
+		return false;
+	});
 	return damagedSomething;
 }
 
 void StudentWorld::destroyActorsIfDeadHelper() {
-	for (list<Actor*>::iterator itr = m_actorList.begin(); itr != m_actorList.end();) {
-		if (!(*itr)->isAlive()) {
-			delete (*itr);
-			(*itr) = nullptr;
-			itr = m_actorList.erase(itr);
+	// Actors that die during a tick stay in place, marked dead, until this
+	// single pass after the tick.  Survivors keep their relative order,
+	// which decides who acts first next tick.
+	size_t numActive = 0;
+	for (size_t i = 0; i < m_activeActors.size(); i++) {
+		if (m_activeActors[i]->isAlive()) m_activeActors[numActive++] = m_activeActors[i];
+	}
+	m_activeActors.resize(numActive);
+	size_t numWatching = 0;
+	for (size_t i = 0; i < m_crystalWatchers.size(); i++) {
+		if (m_crystalWatchers[i]->isAlive()) m_crystalWatchers[numWatching++] = m_crystalWatchers[i];
+	}
+	m_crystalWatchers.resize(numWatching);
+
+	size_t numAlive = 0;
+	for (size_t i = 0; i < m_actorList.size(); i++) {
+		Actor* a = m_actorList[i];
+		if (a->isAlive()) {
+			m_actorList[numAlive++] = a;
 		}
 		else {
-			itr++;
+			removeFromCell(a, a->getX(), a->getY());
+			if (a->hasCapability(Actor::SCHEDULED)) unscheduleRobot(static_cast<Robot*>(a));
+			destroyActor(a);
 		}
 	}
+	m_actorList.resize(numAlive);
 }
 
 bool StudentWorld::anyCrystals() const {
@@ -230,9 +462,201 @@ bool StudentWorld::anyCrystals() const {
 bool StudentWorld::decCrystals() {
 	if (m_amtCrystalsLeft <= 0) return false;
 	m_amtCrystalsLeft--;
+	if (m_amtCrystalsLeft == 0) notifyAllCrystalsCollected();
 	return true;
 }
 
+void StudentWorld::notifyAllCrystalsCollected() {
+	for (size_t i = 0; i < m_crystalWatchers.size(); i++) {
+		if (m_crystalWatchers[i]->isAlive()) m_crystalWatchers[i]->allCrystalsCollected();
+	}
+}
+
+int StudentWorld::randInt(int min, int max) {
+	return m_random.nextInt(min, max);
+}
+
+void StudentWorld::setRandomSeed(uint64_t seed) {
+	m_randomSeed = seed;
+	m_random.setSeed(seed);
+}
+
+uint64_t StudentWorld::getRandomSeed() const {
+	return m_randomSeed;
+}
+
+bool StudentWorld::getKey(int& value) {
+	bool gotKey = GameWorld::getKey(value);
+	if (gotKey && m_recorder != nullptr) m_recorder->keyPressed(m_sessionTick, value);
+	return gotKey;
+}
+
+void StudentWorld::startRecording(ReplayRecorder* recorder) {
+	m_recorder = recorder;
+}
+
+void StudentWorld::makeKeyframe(ReplayKeyframe& keyframe) const {
+	keyframe.tick = m_sessionTick;
+	keyframe.level = getLevel();
+	keyframe.score = getScore();
+	keyframe.lives = getLives();
+	m_random.getState(keyframe.randomState);
+}
+
+void StudentWorld::restoreKeyframe(const ReplayKeyframe& keyframe) {
+	restoreProgress(keyframe.level, keyframe.score, keyframe.lives);
+	m_random.setState(keyframe.randomState);
+	m_sessionTick = keyframe.tick;
+}
+
+long StudentWorld::getSessionTick() const {
+	return m_sessionTick;
+}
+
+void StudentWorld::saveSnapshot(WorldSnapshot& snapshot) const {
+	snapshot.level = getLevel();
+	snapshot.score = getScore();
+	snapshot.lives = getLives();
+	snapshot.bonus = m_bonusScore;
+	snapshot.crystalsLeft = m_amtCrystalsLeft;
+	snapshot.currentTick = m_currentTick;
+	snapshot.sessionTick = m_sessionTick;
+	snapshot.nextSpawnOrder = m_nextSpawnOrder;
+	m_random.getState(snapshot.randomState);
+	snapshot.walls = m_walls;
+	snapshot.player = ActorRecord();
+	snapshot.player.kind = -1;
+	if (m_player != nullptr) m_player->saveState(snapshot.player);
+	snapshot.actors.resize(m_actorList.size());
+	for (size_t i = 0; i < m_actorList.size(); i++) {
+		m_actorList[i]->saveState(snapshot.actors[i]);
+	}
+}
+
+void StudentWorld::restoreSnapshot(const WorldSnapshot& snapshot) {
+	cleanUp();
+	restoreProgress(snapshot.level, snapshot.score, snapshot.lives);
+	m_bonusScore = snapshot.bonus;
+	m_amtCrystalsLeft = snapshot.crystalsLeft;
+	m_currentTick = snapshot.currentTick;
+	m_sessionTick = snapshot.sessionTick;
+	m_random.setState(snapshot.randomState);
+	for (int y = 0; y < VIEW_HEIGHT; y++) {
+		for (int x = 0; x < VIEW_WIDTH; x++) {
+			if (snapshot.walls.test(x, y)) addWall(x, y);
+		}
+	}
+	if (snapshot.player.kind == IID_PLAYER) {
+		m_player = constructActor<Player>(snapshot.player.x, snapshot.player.y);
+		m_player->loadState(snapshot.player);
+		m_playerSquare.set(m_player->getX(), m_player->getY());
+	}
+	// Actors come back in spawn order, just as they were first added, but
+	// without anything on their squares reacting to them
+	m_actorList.reserve(snapshot.actors.size());
+	for (size_t i = 0; i < snapshot.actors.size(); i++) {
+		Actor* a = constructActorFromRecord(snapshot.actors[i]);
+		if (a == nullptr) continue;
+		a->loadState(snapshot.actors[i]);
+		enrollActor(a);
+	}
+	m_nextSpawnOrder = snapshot.nextSpawnOrder;
+	m_clearShotsValid = false;
+	m_clearShotsEpoch++;
+}
+
+bool StudentWorld::saveGame(std::string path) {
+	saveSnapshot(m_snapshotScratch);
+	return writeSavedGame(path, m_snapshotScratch);
+}
+
+bool StudentWorld::loadGame(std::string path) {
+	if (!readSavedGame(path, m_snapshotScratch)) return false;
+	loadSnapshot(m_snapshotScratch);
+	return true;
+}
+
+void StudentWorld::loadSnapshot(const WorldSnapshot& snapshot) {
+	restoreSnapshot(snapshot);
+	// Ticks kept before the load belong to another game
+	m_rewind.clear();
+	keepRewindPoint();
+	// A replay being recorded plays on from the loaded game
+	recordLevelUnderWay();
+}
+
+void StudentWorld::recordLevelUnderWay() {
+	if (m_recorder == nullptr) return;
+	ReplayKeyframe keyframe;
+	makeKeyframe(keyframe);
+	saveSnapshot(m_snapshotScratch);
+	encodeSavedGame(m_snapshotScratch, keyframe.world);
+	m_recorder->levelUnderWay(keyframe);
+}
+
+void StudentWorld::setAutosave(std::string path, int numTicks) {
+	m_autosavePath = path;
+	m_autosaveTicks = numTicks;
+}
+
+Actor* StudentWorld::constructActorFromRecord(const ActorRecord& record) {
+	int x = record.x;
+	int y = record.y;
+	switch (record.kind) {
+	case IID_RAGEBOT:
+		return constructActor<RageBot>(x, y, record.direction);
+	case IID_THIEFBOT:
+		return constructActor<RegularThiefBot>(x, y);
+	case IID_MEAN_THIEFBOT:
+		return constructActor<MeanThiefBot>(x, y);
+	case IID_ROBOT_FACTORY:
+		return constructActor<ThiefBotFactory>(x, y, static_cast<ThiefBotFactory::ProductType>(record.productType));
+	case IID_PEA:
+		return constructActor<Pea>(x, y, record.direction);
+	case IID_EXIT:
+		return constructActor<Exit>(x, y);
+	case IID_MARBLE:
+		return constructActor<Marble>(x, y);
+	case IID_PIT:
+		return constructActor<Pit>(x, y);
+	case IID_CRYSTAL:
+		return constructActor<Crystal>(x, y);
+	case IID_RESTORE_HEALTH:
+		return constructActor<RestoreHealthGoodie>(x, y);
+	case IID_EXTRA_LIFE:
+		return constructActor<ExtraLifeGoodie>(x, y);
+	case IID_AMMO:
+		return constructActor<AmmoGoodie>(x, y);
+	}
+	return nullptr;
+}
+
+void StudentWorld::setRewindLength(int numTicks) {
+	// Going back numTicks ticks takes the state before them as well
+	m_rewind.setCapacity(numTicks > 0 ? numTicks + 1 : 0);
+}
+
+bool StudentWorld::rewind(int numTicks) {
+	WorldSnapshot snapshot;
+	if (!m_rewind.rewind(numTicks, snapshot)) return false;
+	restoreSnapshot(snapshot);
+	return true;
+}
+
+void StudentWorld::keepRewindPoint() {
+	if (m_rewind.getCapacity() == 0) return;
+	saveSnapshot(m_snapshotScratch);
+	m_rewind.record(m_snapshotScratch);
+}
+
+Actor* StudentWorld::getActorBySpawnOrder(int order) const {
+	// m_actorList is always in spawn order
+	vector<Actor*>::const_iterator itr = lower_bound(m_actorList.begin(), m_actorList.end(), order,
+		[](const Actor* a, int order) { return a->getSpawnOrder() < order; });
+	if (itr == m_actorList.end() || (*itr)->getSpawnOrder() != order) return nullptr;
+	return *itr;
+}
+
 void StudentWorld::restorePlayerHealth() {
 	m_player->restoreHealth();
 }
@@ -247,13 +671,11 @@ void StudentWorld::setLevelFinished() {
 	m_gameStatus = GWSTATUS_FINISHED_LEVEL;
 }
 
-bool StudentWorld::getActorsAtPosition(double x, double y, list<Actor*>& actorsAtPosition) const {
-	for (list<Actor*>::const_iterator itr = m_actorList.begin(); itr != m_actorList.end(); itr++) {
-		if ((*itr)->getX() == x && (*itr)->getY() == y) {
-		actorsAtPosition.push_back(*itr);
-		}
-	}
-	if (isPlayerAtPosition(x, y)) actorsAtPosition.push_back(m_player);
+bool StudentWorld::getActorsAtPosition(int x, int y, list<Actor*>& actorsAtPosition) const {
+	forEachActorAt(x, y, [&](Actor* a) {
+		actorsAtPosition.push_back(a);
+		return false;
+	});
 	if (actorsAtPosition.empty()) return false;
 	return true;
 }
@@ -263,7 +685,7 @@ bool StudentWorld::isPlayerColocatedWith(Actor* a) const {
 	return false;
 }
 
-bool StudentWorld::isPlayerAtPosition(double x, double y) const {
+bool StudentWorld::isPlayerAtPosition(int x, int y) const {
 	if (m_player->getX() == x && m_player->getY() == y) return true;
 	return false;
 }
@@ -273,7 +695,168 @@ Player* StudentWorld::getPlayer() {
 }
 
 void StudentWorld::addActor(Actor* actor) {
+	actor->setSpawnOrder(m_nextSpawnOrder++);
+	if (actor->hasCapability(Actor::SCHEDULED)) {
+		// A robot rests through the tick it arrives on (or, before play
+		// starts, the first tick) and the ones after, then acts
+		Robot* r = static_cast<Robot*>(actor);
+		r->setNextActiveTick(m_currentTick + r->getRestTicks() - 1);
+	}
+	notifyColocation(actor, actor->getX(), actor->getY());
+	enrollActor(actor);
+	// An actor born during the tick takes its first turn at the end of
+	// it, unless it is a robot, which rests first
+	if (m_takingTurns && !actor->isInert() && !actor->hasCapability(Actor::SCHEDULED)) m_turnOrder.push_back(actor);
+}
+
+void StudentWorld::enrollActor(Actor* actor) {
 	m_actorList.push_back(actor);
+	if (actor->hasCapability(Actor::SCHEDULED)) {
+		Robot* r = static_cast<Robot*>(actor);
+		scheduleRobot(r, r->getNextActiveTick());
+	}
+	else if (!actor->isInert()) {
+		m_activeActors.push_back(actor);
+	}
+	if (actor->hasCapability(Actor::WAITS_FOR_CRYSTALS)) m_crystalWatchers.push_back(actor);
+	addToCell(actor, actor->getX(), actor->getY());
+}
+
+void StudentWorld::destroyActor(Actor* a) {
+	a->~Actor();
+	m_arena.deallocate(a);
+}
+
+void StudentWorld::actorMoved(Actor* a, int oldX, int oldY) {
+	// The player is tracked separately from the actors in m_actorList
+	if (a == m_player) {
+		m_playerSquare.reset(oldX, oldY);
+		m_playerSquare.set(a->getX(), a->getY());
+		m_changedSquares.set(oldX, oldY);
+		m_changedSquares.set(a->getX(), a->getY());
+		m_clearShotsValid = false;
+		m_clearShotsEpoch++;
+	}
+	else {
+		removeFromCell(a, oldX, oldY);
+		addToCell(a, a->getX(), a->getY());
+	}
+	notifyColocation(a, a->getX(), a->getY());
+}
+
+void StudentWorld::notifyColocation(Actor* a, int x, int y) {
+	// Pickups and exits only care when the player arrives, and pits when
+	// something swallowable does.  Anything else coming and going, which
+	// is the usual case, has nobody to tell.
+	if (!isInBounds(x, y)) return;
+	const SquareCounts& counts = m_squareCounts[y][x];
+	bool squareReacts = (a == m_player && counts.playerReactors > 0) ||
+		(a->isSwallowable() && counts.swallowableReactors > 0);
+	// A reactor can arrive too, like a goodie dropped by a ThiefBot
+	bool aReacts = (a->getCapabilities() & (Actor::REACTS_TO_PLAYER | Actor::REACTS_TO_SWALLOWABLE)) != 0;
+	if (!squareReacts && !aReacts) return;
+
+	forEachActorAt(x, y, [&](Actor* other) {
+		if (other == a) return false;
+		if (squareReacts && reactsTo(other, a)) {
+			PROFILE_TICK_SECTION(m_profiler, TickProfiler::REACT + other->getKind());
+			other->sharedSquareWith(a);
+		}
+		if (aReacts && reactsTo(a, other)) {
+			PROFILE_TICK_SECTION(m_profiler, TickProfiler::REACT + a->getKind());
+			a->sharedSquareWith(other);
+		}
+		return false;
+	});
+}
+
+bool StudentWorld::reactsTo(const Actor* reactor, const Actor* other) const {
+	if (reactor->hasCapability(Actor::REACTS_TO_PLAYER) && other == m_player) return true;
+	return reactor->hasCapability(Actor::REACTS_TO_SWALLOWABLE) && other->isSwallowable();
+}
+
+bool StudentWorld::isInBounds(int x, int y) const {
+	return x >= 0 && x < VIEW_WIDTH && y >= 0 && y < VIEW_HEIGHT;
+}
+
+void StudentWorld::addToCell(Actor* a, int x, int y) {
+	if (!isInBounds(x, y)) return;
+	vector<Actor*>& cell = m_cells[y][x];
+	vector<Actor*>::iterator pos = cell.end();
+	while (pos != cell.begin() && (*(pos - 1))->getSpawnOrder() > a->getSpawnOrder()) {
+		pos--;
+	}
+	cell.insert(pos, a);
+	m_changedSquares.set(x, y);
+	countCapabilitiesOnSquare(a->getCapabilities(), x, y, 1);
+}
+
+void StudentWorld::removeFromCell(Actor* a, int x, int y) {
+	if (!isInBounds(x, y)) return;
+	vector<Actor*>& cell = m_cells[y][x];
+	for (vector<Actor*>::iterator itr = cell.begin(); itr != cell.end(); itr++) {
+		if ((*itr) == a) {
+			cell.erase(itr);
+			m_changedSquares.set(x, y);
+			countCapabilitiesOnSquare(a->getCapabilities(), x, y, -1);
+			return;
+		}
+	}
+}
+
+static void adjustSquareCount(int& count, int delta, Bitboard& plane, int x, int y) {
+	count += delta;
+	if (count > 0) plane.set(x, y);
+	else plane.reset(x, y);
+}
+
+void StudentWorld::countCapabilitiesOnSquare(unsigned int capabilities, int x, int y, int delta) {
+	SquareCounts& counts = m_squareCounts[y][x];
+	bool wasObstructed = counts.peaBlockers > 0 || counts.damageables > 0;
+	if (capabilities & Actor::STOPS_PEA)
+		adjustSquareCount(counts.peaBlockers, delta, m_peaBlockers, x, y);
+	if (!(capabilities & Actor::ALLOWS_AGENT_COLOCATION))
+		adjustSquareCount(counts.agentBlockers, delta, m_agentBlockers, x, y);
+	if (!(capabilities & Actor::ALLOWS_MARBLE))
+		adjustSquareCount(counts.marbleBlockers, delta, m_marbleBlockers, x, y);
+	if (capabilities & Actor::DAMAGEABLE)
+		adjustSquareCount(counts.damageables, delta, m_damageables, x, y);
+	if (capabilities & Actor::COUNTS_IN_FACTORY_CENSUS)
+		counts.censusActors += delta;
+	if (capabilities & Actor::REACTS_TO_PLAYER)
+		counts.playerReactors += delta;
+	if (capabilities & Actor::REACTS_TO_SWALLOWABLE)
+		counts.swallowableReactors += delta;
+	bool isObstructed = counts.peaBlockers > 0 || counts.damageables > 0;
+	if (isObstructed != wasObstructed) invalidateClearShotsThrough(x, y);
+}
+
+void StudentWorld::addWall(int x, int y) {
+	if (!isInBounds(x, y)) return;
+	m_walls.set(x, y);
+	// A wall blocks peas, agents and marbles for as long as the level lasts
+	countCapabilitiesOnSquare(Actor::STOPS_PEA, x, y, 1);
+}
+
+int StudentWorld::getTerrainAt(int x, int y) const {
+	if (m_walls.test(x, y)) return IID_WALL;
+	return -1;
+}
+
+void StudentWorld::clearSquares() {
+	for (int y = 0; y < VIEW_HEIGHT; y++) {
+		for (int x = 0; x < VIEW_WIDTH; x++) {
+			m_cells[y][x].clear();
+			m_squareCounts[y][x] = SquareCounts{ 0, 0, 0, 0, 0, 0, 0 };
+		}
+	}
+	m_peaBlockers.clear();
+	m_agentBlockers.clear();
+	m_marbleBlockers.clear();
+	m_damageables.clear();
+	m_playerSquare.clear();
+	m_walls.clear();
+	m_clearShotsValid = false;
 }
 
 int StudentWorld::getBonus() const {
@@ -294,58 +877,63 @@ int StudentWorld::loadLevel(std::string levelName) {
 	else if (result == Level::load_success) {
 		std::cerr << "Successfully loaded level\n";
 	}
+	loadLevel(lev);
+	return 0;
+}
+
+void StudentWorld::loadLevel(const Level& lev) {
+	// Play on the new level starts with tick 1
+	m_currentTick = 1;
 
 	for (int y = 0; y <= 14; y++) {
 		for (int x = 0; x <= 14; x++) {
-			double actorX, actorY;
-			actorX = x;
-			actorY = y;
 			Level::MazeEntry item = lev.getContentsOf(x, y);
 			switch (item) {
 			case Level::ammo:
-				m_actorList.push_back(new AmmoGoodie(this, x, y));
+				createActor<AmmoGoodie>(x, y);
 				break;
 			case Level::crystal:
 				m_amtCrystalsLeft++;
-				m_actorList.push_back(new Crystal(this, x, y));
+				createActor<Crystal>(x, y);
 				break;
 			case Level::exit:
-				m_actorList.push_back(new Exit(this, x, y));
+				createActor<Exit>(x, y);
 				break;
 			case Level::extra_life:
-				m_actorList.push_back(new ExtraLifeGoodie(this, x, y));
+				createActor<ExtraLifeGoodie>(x, y);
 				break;
 			case Level::horiz_ragebot:
-				m_actorList.push_back(new RageBot(this, x, y, 0));
+				createActor<RageBot>(x, y, 0);
 				break;
 			case Level::marble:
-				m_actorList.push_back(new Marble(this, x, y));
+				createActor<Marble>(x, y);
 				break;
 			case Level::mean_thiefbot_factory:
-				m_actorList.push_back(new ThiefBotFactory(this, x, y, ThiefBotFactory::MEAN));
+				createActor<ThiefBotFactory>(x, y, ThiefBotFactory::MEAN);
 				break;
 			case Level::pit:
-				m_actorList.push_back(new Pit(this, x, y));
+				createActor<Pit>(x, y);
 				break;
 			case Level::player:
-				m_player = new Player(this, x, y);
+				m_player = constructActor<Player>(x, y);
+				m_playerSquare.set(x, y);
+				m_clearShotsValid = false;
 				break;
 			case Level::restore_health:
-				m_actorList.push_back(new RestoreHealthGoodie(this, x, y));
+				createActor<RestoreHealthGoodie>(x, y);
 				break;
 			case Level::thiefbot_factory:
-				m_actorList.push_back(new ThiefBotFactory(this, x, y, ThiefBotFactory::REGULAR));
+				createActor<ThiefBotFactory>(x, y, ThiefBotFactory::REGULAR);
 				break;
 			case Level::vert_ragebot:
-				m_actorList.push_back(new RageBot(this, x, y, 270));
+				createActor<RageBot>(x, y, 270);
 				break;
 			case Level::wall:
-				m_actorList.push_back(new Wall(this, x, y));
+				addWall(x, y);
 				break;
 			}
 		}
 	}
-	return 0;
 }
 
 std::string StudentWorld::formatInfo(int score, int level, int lives, int health, int numPeas, int bonus) {
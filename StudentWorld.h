@@ -2,13 +2,26 @@
 #define STUDENTWORLD_H_
 
 #include "GameWorld.h"
+#include "Bitboard.h"
+#include "ActorArena.h"
+#include "RandomGenerator.h"
+#include "WorldSnapshot.h"
+#include "TickProfiler.h"
+#include "BatchRunner.h"
 #include <list>
+#include <vector>
+#include <new>
 
 using namespace std;
 
 class Actor;
 class Agent;
 class Player;
+class Robot;
+struct ActorIntent;
+class ReplayRecorder;
+class Level;
+struct ReplayKeyframe;
 
 // Note:  A convention used in a number of interfaces is to represent a
 // direction with the adjustments to x and y needed to move one step in
@@ -27,14 +40,23 @@ public:
     virtual int init();
     virtual int move();
     virtual void cleanUp();
+    virtual int getTerrainAt(int x, int y) const;
 
 
     // Can agent move to x,y?  (dx and dy indicate the direction of motion)
-    bool canAgentMoveTo(Agent* agent, double x, double y, int dx, int dy) const;
+    bool canAgentMoveTo(Agent* agent, int x, int y, int dx, int dy) const;
 
     // Can a marble move to x,y?
     bool canMarbleMoveTo(int x, int y) const;
 
+    // Can a robot move to x,y?  (Robots can't push marbles, so this is
+    // canAgentMoveTo for them.)
+    bool isOpenToRobots(int x, int y) const;
+
+    // Would a pea at x,y be stopped there?  (This is what damageSomething
+    // returns for a pea at x,y, without damaging anything.)
+    bool wouldStopPea(int x, int y) const;
+
     //Is the player on the same square as an Actor?
     bool isPlayerColocatedWith(Actor* a) const;
 
@@ -79,23 +101,115 @@ public:
     // Indicate that the player has finished the level.
     void setLevelFinished();
 
-    // Add an actor to the world
-    void addActor(Actor* a);
+    // Return a uniformly distributed random int from min to max,
+    // inclusive, from this world's own generator.
+    int randInt(int min, int max);
+
+    // Restart this world's random numbers from seed.  A world is seeded
+    // unpredictably when it is made; seed it to make a game repeatable.
+    void setRandomSeed(uint64_t seed);
+    uint64_t getRandomSeed() const;
+
+    // Get the key the player pressed, if any, recording it if this world
+    // is being recorded.  (This hides GameWorld::getKey, which is what
+    // actually asks for the key.)
+    bool getKey(int& value);
+
+    // Record the keys pressed, a keyframe at each level start and one
+    // holding the whole world every 500 ticks to recorder, from the next
+    // level start or loaded game on.  recorder must outlive this world or
+    // the recording.
+    void startRecording(ReplayRecorder* recorder);
+
+    // Go back to the point a level start keyframe was taken, just before
+    // its level started.  The next init starts that level.  (A keyframe
+    // within a level is a saved game, for restoreSnapshot.)
+    void restoreKeyframe(const ReplayKeyframe& keyframe);
+
+    // How many ticks this world has played, across all its levels
+    long getSessionTick() const;
+
+    // Copy the whole state of the level in play into snapshot.  Call this
+    // between ticks.
+    void saveSnapshot(WorldSnapshot& snapshot) const;
+
+    // Put the world back the way it was when snapshot was taken, in place
+    // of whatever level is in play.  The next move plays on from there.
+    // snapshot must have been taken with a level in play, so that it has
+    // a player.
+    void restoreSnapshot(const WorldSnapshot& snapshot);
+
+    // Keep the state at each level start and after each of the last
+    // numTicks ticks, so the world can be rewound.  (At the usual 10 ms a
+    // tick, that is numTicks / 100 seconds.)  0, the default, keeps none.
+    void setRewindLength(int numTicks);
+
+    // Go back numTicks ticks, undoing them.  Return false, changing
+    // nothing, if the world hasn't kept that many.
+    bool rewind(int numTicks);
+
+    // Save the game in play to path, or load the game saved there in
+    // place of the level in play.  Return false if the file can't be
+    // written, or read as a saved game.  Loading forgets the ticks kept
+    // for rewinding.
+    bool saveGame(std::string path);
+    bool loadGame(std::string path);
+
+    // Load a saved game already read into snapshot, just as loadGame does.
+    // A recording in progress gets a keyframe of it.
+    void loadSnapshot(const WorldSnapshot& snapshot);
+
+    // Save the game to path every numTicks ticks.  0 stops saving.
+    void setAutosave(std::string path, int numTicks);
+
+    // The actor added to the world in the given order, or a null pointer
+    // if it is gone
+    Actor* getActorBySpawnOrder(int order) const;
+
+    // Make a new actor in this level's memory and add it to the world.
+    // The arguments are those of the actor's constructor after the world.
+    template<typename ActorType, typename... Args>
+    ActorType* createActor(Args... args);
 
     //Help destroy actors if dead
     void destroyActorsIfDeadHelper();
 
+    // Choose how each tick is run.  With numThreads of 1 or less (the
+    // default) actors take their turns one after another, each deciding
+    // and then acting.  Otherwise every actor due to act first decides in
+    // parallel on up to numThreads threads, and then they act one at a
+    // time in the usual order.  An actor whose surroundings changed
+    // between its decision and its turn decides again, so both ways give
+    // the same game.  Decisions are only split between threads in
+    // stretches of at least minDecisionsPerThread actors; the default
+    // suits how long a decision takes, and 1 splits every tick's.
+    void setTwoPhaseTicks(int numThreads);
+    void setTwoPhaseTicks(int numThreads, int minDecisionsPerThread);
+
+    // Update the occupancy grid after a moved here from oldX,oldY
+    void actorMoved(Actor* a, int oldX, int oldY);
+
     // Format top info
     std::string formatInfo(int score, int level, int lives, int health, int numPeas, int bonus);
 
     //Load Level
     int loadLevel(string levelName);
 
+    // Set up the actors and walls of lev, which has already been loaded
+    // or made, in place of the level file
+    void loadLevel(const Level& lev);
+
     //Gets an actor at a given position
-    bool getActorsAtPosition(double x, double y, list<Actor*>& actorsAtPosition) const;
+    bool getActorsAtPosition(int x, int y, list<Actor*>& actorsAtPosition) const;
+
+    // Call visit(actor) for each actor at x,y, ending with the player if
+    // the player is there, without building a list.  Stop and return true
+    // as soon as visit returns true; otherwise return false.
+    template<typename Visitor>
+    bool forEachActorAt(int x, int y, Visitor visit) const;
 
     //Is the player at a given position
-    bool isPlayerAtPosition(double x, double y) const;
+    bool isPlayerAtPosition(int x, int y) const;
 
     //Gets the player
     Player* getPlayer();
@@ -105,11 +219,158 @@ public:
     int findDistanceHelper(int val1, int val2) const;
 
 private:
-    list<Actor*> m_actorList;
+    ActorArena m_arena;
+    RandomGenerator m_random;
+    uint64_t m_randomSeed;
+    ReplayRecorder* m_recorder;
+    long m_sessionTick;
+    RewindBuffer m_rewind;
+    WorldSnapshot m_snapshotScratch;
+    std::string m_autosavePath;
+    int m_autosaveTicks;
+#ifdef PROFILE_TICKS
+    TickProfiler m_profiler;
+#endif
+    vector<Actor*> m_actorList;
+    // The actors that do something each tick (not marbles, pits or
+    // robots), in spawn order
+    vector<Actor*> m_activeActors;
+
+    // Robots rest between actions, so rather than visit them every tick
+    // the world files each one in a timer wheel under the tick it next
+    // acts on.  Slot t % ROBOT_WHEEL_SIZE holds the robots due on tick t.
+    static const int ROBOT_WHEEL_SIZE = 8;
+    vector<Robot*> m_robotWheel[ROBOT_WHEEL_SIZE];
+    int m_currentTick;
+
+    // The actors taking turns this tick, in spawn order: m_activeActors
+    // merged with the robots due, taken off the wheel into m_dueRobots
+    vector<Actor*> m_turnOrder;
+    vector<Robot*> m_dueRobots;
+    bool m_takingTurns;
+
+    // Actors to tell when the last crystal is collected
+    vector<Actor*> m_crystalWatchers;
+    // Actors in m_actorList indexed by the square they occupy, each
+    // square kept in the same order as m_actorList
+    vector<Actor*> m_cells[VIEW_HEIGHT][VIEW_WIDTH];
+    int m_nextSpawnOrder;
+
+    // How many actors on each square have each property tracked by the
+    // bitboards below.  A square's bit is set while its count is nonzero.
+    struct SquareCounts
+    {
+        int peaBlockers;
+        int agentBlockers;
+        int marbleBlockers;
+        int damageables;
+        int censusActors;
+        int playerReactors;
+        int swallowableReactors;
+    };
+    SquareCounts m_squareCounts[VIEW_HEIGHT][VIEW_WIDTH];
+    Bitboard m_peaBlockers;
+    Bitboard m_agentBlockers;
+    Bitboard m_marbleBlockers;
+    Bitboard m_damageables;
+    Bitboard m_playerSquare;
+    // Walls are not actors: they never move or change, so a level's walls
+    // are just the squares they fill
+    Bitboard m_walls;
+
+    // Squares from which a pea fired right, left, up or down would reach
+    // the player unobstructed.  Rebuilt on demand after the player moves
+    // or an obstruction on the player's row or column appears or goes.
+    mutable Bitboard m_clearShotsFrom[4];
+    mutable bool m_clearShotsValid;
     Player* m_player;
     int m_bonusScore;
     int m_amtCrystalsLeft;
     int m_gameStatus;
+
+    // Make a new actor in this level's memory without adding it
+    template<typename ActorType, typename... Args>
+    ActorType* constructActor(Args... args);
+    void addActor(Actor* a);
+    void enrollActor(Actor* a);
+    Actor* constructActorFromRecord(const ActorRecord& record);
+    void keepRewindPoint();
+    void makeKeyframe(ReplayKeyframe& keyframe) const;
+    void recordLevelUnderWay();
+    void destroyActor(Actor* a);
+    void notifyColocation(Actor* a, int x, int y);
+    bool reactsTo(const Actor* reactor, const Actor* other) const;
+    void notifyAllCrystalsCollected();
+    void scheduleRobot(Robot* r, int tick);
+    void unscheduleRobot(Robot* r);
+    bool takeTurns();
+    void takeDueRobots();
+
+    bool isInBounds(int x, int y) const;
+    void addToCell(Actor* a, int x, int y);
+    void removeFromCell(Actor* a, int x, int y);
+    void countCapabilitiesOnSquare(unsigned int capabilities, int x, int y, int delta);
+    void addWall(int x, int y);
+    void clearSquares();
+    void invalidateClearShotsThrough(int x, int y);
+    void updateClearShots() const;
+
+    // Two-phase ticks
+    int m_decideThreads;
+    int m_minDecisionsPerThread;
+    BatchRunner* m_decidePool;
+    vector<ActorIntent> m_intents;
+    // Squares whose occupants changed since the current group decided,
+    // and how many times the clear shot table has been invalidated
+    Bitboard m_changedSquares;
+    int m_clearShotsEpoch;
+    int m_clearShotsEpochAtDecide;
+    template<typename ActorType>
+    void decideAll(const vector<ActorType*>& actors);
+    void actOnDecision(Actor* a, ActorIntent& intent);
+    bool changedNear(int x, int y) const;
 };
 
+template<typename ActorType, typename... Args>
+ActorType* StudentWorld::createActor(Args... args) {
+	ActorType* actor = constructActor<ActorType>(args...);
+	addActor(actor);
+	return actor;
+}
+
+template<typename ActorType, typename... Args>
+ActorType* StudentWorld::constructActor(Args... args) {
+	return new (m_arena.allocate(sizeof(ActorType))) ActorType(this, args...);
+}
+
+template<typename Visitor>
+bool StudentWorld::forEachActorAt(int x, int y, Visitor visit) const {
+	// Visit a copy of the square: damaging or pushing an actor can change
+	// what is on the square while we're visiting it.
+	const size_t INLINE_CAPACITY = 8;
+	Actor* inlineActors[INLINE_CAPACITY];
+	vector<Actor*> overflow;  // only allocates for unusually crowded squares
+	Actor** actors = inlineActors;
+	size_t numActors = 0;
+	if (isInBounds(x, y)) {
+		const vector<Actor*>& cell = m_cells[y][x];
+		numActors = cell.size();
+		if (numActors > INLINE_CAPACITY) {
+			overflow.assign(cell.begin(), cell.end());
+			actors = overflow.data();
+		}
+		else {
+			for (size_t i = 0; i < numActors; i++)
+				inlineActors[i] = cell[i];
+		}
+	}
+	bool playerIsHere = m_playerSquare.test(x, y);
+
+	for (size_t i = 0; i < numActors; i++) {
+		if (visit(actors[i])) return true;
+	}
+	if (playerIsHere && visit(m_player)) return true;
+	return false;
+}
+
 #endif // STUDENTWORLD_H_
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "TickProfiler.h"
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <string>
+using namespace std;
+
+namespace
+{
+	const char* const KIND_NAMES[TickProfiler::NUM_KINDS] = {
+		"Player", "RageBot", "ThiefBot", "MeanThiefBot", "Factory", "Pea", "Wall",
+		"Exit", "Marble", "Pit", "Crystal", "RestoreHealth", "ExtraLife", "Ammo"
+	};
+
+	  // The timings of every world destroyed so far, reported at exit
+	struct ProcessTotals
+	{
+		mutex lock;
+		TickProfiler profile;
+		bool anyAdded = false;
+
+		~ProcessTotals()
+		{
+			if (!anyAdded)
+				return;
+			cerr << "Tick profile (microseconds):" << endl;
+			profile.report(cerr);
+		}
+	};
+
+	ProcessTotals& processTotals()
+	{
+		static ProcessTotals totals;
+		return totals;
+	}
+}
+
+TickProfiler::TickProfiler()
+{
+	clear();
+}
+
+void TickProfiler::clear()
+{
+	for (int section = 0; section < NUM_SECTIONS; section++)
+	{
+		Histogram& h = m_sections[section];
+		h.calls = 0;
+		h.totalNanoseconds = 0;
+		h.maxNanoseconds = 0;
+		for (int bucket = 0; bucket < NUM_BUCKETS; bucket++)
+			h.buckets[bucket] = 0;
+	}
+}
+
+void TickProfiler::record(int section, int64_t nanoseconds)
+{
+	Histogram& h = m_sections[section];
+	h.calls++;
+	h.totalNanoseconds += nanoseconds;
+	if (nanoseconds > h.maxNanoseconds)
+		h.maxNanoseconds = nanoseconds;
+	h.buckets[bucketFor(nanoseconds)]++;
+}
+
+void TickProfiler::addToProcessTotals()
+{
+	ProcessTotals& totals = processTotals();
+	lock_guard<mutex> guard(totals.lock);
+	for (int section = 0; section < NUM_SECTIONS; section++)
+	{
+		const Histogram& from = m_sections[section];
+		Histogram& to = totals.profile.m_sections[section];
+		if (from.calls == 0)
+			continue;
+		to.calls += from.calls;
+		to.totalNanoseconds += from.totalNanoseconds;
+		if (from.maxNanoseconds > to.maxNanoseconds)
+			to.maxNanoseconds = from.maxNanoseconds;
+		for (int bucket = 0; bucket < NUM_BUCKETS; bucket++)
+			to.buckets[bucket] += from.buckets[bucket];
+		totals.anyAdded = true;
+	}
+	clear();
+}
+
+void TickProfiler::report(ostream& out) const
+{
+	out << left << setw(32) << "section" << right << setw(12) << "calls" << setw(14) << "total"
+		<< setw(10) << "p50" << setw(10) << "p99" << setw(10) << "max" << endl;
+	out << fixed << setprecision(1);
+	for (int section = 0; section < NUM_SECTIONS; section++)
+	{
+		const Histogram& h = m_sections[section];
+		if (h.calls == 0)
+			continue;
+		bool isReaction;
+		string name = sectionName(section, isReaction);
+		if (section < TICK)
+			name += isReaction ? " sharedSquareWith" : " doSomething";
+		out << left << setw(32) << name << right << setw(12) << h.calls
+			<< setw(14) << h.totalNanoseconds / 1000.0
+			<< setw(10) << percentile(h, 0.50) / 1000.0
+			<< setw(10) << percentile(h, 0.99) / 1000.0
+			<< setw(10) << h.maxNanoseconds / 1000.0 << endl;
+	}
+	out.unsetf(ios::fixed);
+}
+
+int TickProfiler::bucketFor(int64_t nanoseconds)
+{
+	if (nanoseconds <= 0)
+		return 0;
+	int octave = 0;
+	while ((nanoseconds >> octave) > 1)
+		octave++;
+	  // The two bits after the leading one pick the quarter of the octave
+	int quarter = static_cast<int>(((nanoseconds << 2) >> octave) & (SUB_BUCKETS - 1));
+	int bucket = octave * SUB_BUCKETS + quarter;
+	return bucket < NUM_BUCKETS ? bucket : NUM_BUCKETS - 1;
+}
+
+int64_t TickProfiler::bucketUpperBound(int bucket)
+{
+	int octave = bucket / SUB_BUCKETS;
+	int quarter = bucket % SUB_BUCKETS;
+	return (int64_t(1) << octave) * (SUB_BUCKETS + quarter + 1) / SUB_BUCKETS;
+}
+
+int64_t TickProfiler::percentile(const Histogram& h, double fraction)
+{
+	int64_t wanted = static_cast<int64_t>(fraction * h.calls + 0.5);
+	if (wanted < 1)
+		wanted = 1;
+	int64_t seen = 0;
+	for (int bucket = 0; bucket < NUM_BUCKETS; bucket++)
+	{
+		seen += h.buckets[bucket];
+		if (seen >= wanted)
+		{
+			  // No time is reported above the slowest call actually seen
+			int64_t bound = bucketUpperBound(bucket);
+			return bound < h.maxNanoseconds ? bound : h.maxNanoseconds;
+		}
+	}
+	return h.maxNanoseconds;
+}
+
+const char* TickProfiler::sectionName(int section, bool& isReaction)
+{
+	isReaction = section >= REACT && section < TICK;
+	if (section < TICK)
+		return KIND_NAMES[section % NUM_KINDS];
+	switch (section)
+	{
+	  case TICK:
+		return "tick";
+	  case DESTROY_DEAD:
+		return "destroyActorsIfDead";
+	  case FORMAT_HUD:
+		return "format HUD";
+	  case TURN_ORDER:
+		return "turn order";
+	}
+	return "?";
+}
@@ -0,0 +1,98 @@
+#ifndef TICKPROFILER_H_
+#define TICKPROFILER_H_
+
+#include "GameConstants.h"
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+// Timing of what a world spends its ticks on, for finding which behaviors
+// blow the tick budget.  It is compiled in only when PROFILE_TICKS is
+// defined; otherwise the PROFILE_TICK_SECTION macro below expands to
+// nothing and the world has no profiler at all.
+//
+// Each world times its own ticks.  When a world is destroyed its timings
+// are added to the process's, which are written to standard error as
+// histograms (calls, total, p50, p99, max per section) when the program
+// exits.  Sections nest: a pickup taken during the player's move counts
+// toward both the pickup and the player.
+
+class TickProfiler
+{
+public:
+	  // Sections 0 to NUM_KINDS - 1 are each kind of actor's doSomething,
+	  // and the NUM_KINDS after them its sharedSquareWith (what pits and
+	  // pickups do instead of acting), by image ID
+	static const int NUM_KINDS = IID_AMMO + 1;
+	static const int REACT = NUM_KINDS;
+	static const int TICK = 2 * NUM_KINDS;
+	static const int DESTROY_DEAD = TICK + 1;
+	static const int FORMAT_HUD = TICK + 2;
+	static const int TURN_ORDER = TICK + 3;
+	static const int NUM_SECTIONS = TICK + 4;
+
+	TickProfiler();
+
+	void record(int section, int64_t nanoseconds);
+
+	  // Add this profiler's timings to the process's and start afresh
+	void addToProcessTotals();
+
+	  // Write one line per section that has been timed
+	void report(std::ostream& out) const;
+
+	  // Times the rest of the enclosing block as one call of a section
+	class Scope
+	{
+	public:
+		Scope(TickProfiler& profiler, int section)
+		 : m_profiler(profiler), m_section(section), m_start(std::chrono::steady_clock::now())
+		{
+		}
+
+		~Scope()
+		{
+			std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - m_start;
+			m_profiler.record(m_section, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+		}
+
+	private:
+		TickProfiler& m_profiler;
+		int m_section;
+		std::chrono::steady_clock::time_point m_start;
+	};
+
+private:
+	  // Times are filed in buckets four to each power of two of
+	  // nanoseconds, so a percentile is read to within a quarter of an
+	  // octave, whatever the spread
+	static const int SUB_BUCKETS = 4;
+	static const int NUM_BUCKETS = 48 * SUB_BUCKETS;  // up to 2^48 ns, some 78 hours
+
+	struct Histogram
+	{
+		int64_t calls;
+		int64_t totalNanoseconds;
+		int64_t maxNanoseconds;
+		int64_t buckets[NUM_BUCKETS];
+	};
+
+	Histogram m_sections[NUM_SECTIONS];
+
+	void clear();
+	static int bucketFor(int64_t nanoseconds);
+	static int64_t bucketUpperBound(int bucket);
+	static int64_t percentile(const Histogram& h, double fraction);
+	static const char* sectionName(int section, bool& isReaction);
+};
+
+#ifdef PROFILE_TICKS
+#define PROFILE_TICK_JOIN2(a, b) a##b
+#define PROFILE_TICK_JOIN(a, b) PROFILE_TICK_JOIN2(a, b)
+#define PROFILE_TICK_SECTION(profiler, section) \
+	TickProfiler::Scope PROFILE_TICK_JOIN(profileScope, __LINE__)(profiler, section)
+#else
+#define PROFILE_TICK_SECTION(profiler, section)
+#endif
+
+#endif // TICKPROFILER_H_
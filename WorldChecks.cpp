@@ -0,0 +1,302 @@
+#include "WorldChecks.h"
+#include "StudentWorld.h"
+#include "HeadlessGame.h"
+#include "LevelGenerator.h"
+#include "Actor.h"
+#include <functional>
+#include <vector>
+using namespace std;
+
+static const int TWO_PHASE_THREADS = 4;
+static const int REWIND_TICKS = 40;
+static const int TICKS_BETWEEN_REWINDS = 100;
+static const int TICKS_BETWEEN_BAD_SAVES = 100;
+static const int MAX_TICKS_BEFORE_DYING = 20;
+
+  // Random keys, each kept by the tick it was asked for on, so that ticks
+  // played again after a rewind get the same keys as the first time
+class RewindableKeySource : public KeySource
+{
+public:
+	RewindableKeySource(unsigned int seed, const StudentWorld& world)
+	 : m_random(seed), m_world(world)
+	{
+	}
+
+	virtual bool getKey(int& value)
+	{
+		size_t tick = static_cast<size_t>(m_world.getSessionTick());
+		if (tick >= m_keys.size())
+		{
+			m_keys.resize(tick + 1, INVALID_KEY);
+			int key;
+			if (m_random.getKey(key))
+				m_keys[tick] = key;
+		}
+		value = m_keys[tick];
+		return value != INVALID_KEY;
+	}
+
+private:
+	RandomKeySource m_random;
+	const StudentWorld& m_world;
+	vector<int> m_keys;
+};
+
+static void mix(uint64_t& hash, int64_t value)
+{
+	  // FNV-1a, a byte at a time
+	for (int i = 0; i < 8; i++)
+	{
+		hash ^= static_cast<uint64_t>(value >> (8 * i)) & 0xff;
+		hash *= 1099511628211ULL;
+	}
+}
+
+static void mix(uint64_t& hash, const ActorRecord& record)
+{
+	const int64_t fields[] = {
+		record.kind, record.spawnOrder, record.x, record.y, record.direction, record.hitPoints,
+		record.visible, record.revealed, record.ammo, record.nextActiveTick,
+		record.distanceBeforeTurning, record.stolenGoodie, record.productType
+	};
+	for (size_t i = 0; i < sizeof(fields) / sizeof(fields[0]); i++)
+		mix(hash, fields[i]);
+}
+
+  // A hash of everything a snapshot of world holds
+static uint64_t fingerprint(const StudentWorld& world)
+{
+	WorldSnapshot snapshot;
+	world.saveSnapshot(snapshot);
+	uint64_t hash = 14695981039346656037ULL;
+	const int64_t counters[] = {
+		snapshot.level, snapshot.score, snapshot.lives, snapshot.bonus, snapshot.crystalsLeft,
+		snapshot.currentTick, snapshot.sessionTick, snapshot.nextSpawnOrder
+	};
+	for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++)
+		mix(hash, counters[i]);
+	for (int i = 0; i < RandomGenerator::STATE_WORDS; i++)
+		mix(hash, static_cast<int64_t>(snapshot.randomState[i]));
+	mix(hash, snapshot.player);
+	for (size_t i = 0; i < snapshot.actors.size(); i++)
+		mix(hash, snapshot.actors[i]);
+	return hash;
+}
+
+  // Play game number game of options, calling setUp on its world first
+  // and observe on it after every tick
+static HeadlessResult playSeededGame(const CheckOptions& options, int game,
+	const function<void(StudentWorld&)>& setUp, const function<void(StudentWorld&, int)>& observe)
+{
+	StudentWorld world(options.assetPath);
+	world.setRandomSeed(options.seed + game);
+	setUp(world);
+	RewindableKeySource keys(static_cast<unsigned int>(options.seed + game), world);
+	HeadlessGame headless(&world, &keys);
+	headless.setTickObserver([&](int status) { observe(world, status); });
+	return headless.play(options.maxTicks);
+}
+
+bool checkTwoPhaseTicks(const CheckOptions& options, ostream& out)
+{
+	long ticksCompared = 0;
+	for (int game = 0; game < options.numGames; game++)
+	{
+		vector<uint64_t> serial;
+		playSeededGame(options, game, [](StudentWorld&) {}, [&](StudentWorld& world, int) {
+			serial.push_back(fingerprint(world));
+		});
+
+		size_t tick = 0;
+		long firstDifference = -1;
+		playSeededGame(options, game, [](StudentWorld& world) {
+			world.setTwoPhaseTicks(TWO_PHASE_THREADS, 1);
+		}, [&](StudentWorld& world, int) {
+			if (firstDifference < 0 && (tick >= serial.size() || fingerprint(world) != serial[tick]))
+				firstDifference = static_cast<long>(tick) + 1;
+			tick++;
+		});
+		if (firstDifference < 0 && tick != serial.size())
+			firstDifference = static_cast<long>(tick) + 1;
+		if (firstDifference >= 0)
+		{
+			out << "two-phase ticks: game " << game << " differs from serial play at tick "
+				<< firstDifference << endl;
+			return false;
+		}
+		ticksCompared += static_cast<long>(tick);
+	}
+	out << "two-phase ticks: " << options.numGames << " games, " << ticksCompared
+		<< " ticks the same as serial play" << endl;
+	return true;
+}
+
+bool checkSnapshots(const CheckOptions& options, ostream& out)
+{
+	long ticksCompared = 0;
+	for (int game = 0; game < options.numGames; game++)
+	{
+		StudentWorld copy(options.assetPath);
+		WorldSnapshot taken;
+		WorldSnapshot restored;
+		long tick = 0;
+		long firstDifference = -1;
+		playSeededGame(options, game, [](StudentWorld&) {}, [&](StudentWorld& world, int) {
+			tick++;
+			if (firstDifference >= 0)
+				return;
+			world.saveSnapshot(taken);
+			copy.restoreSnapshot(taken);
+			copy.saveSnapshot(restored);
+			if (restored != taken)
+				firstDifference = tick;
+		});
+		if (firstDifference >= 0)
+		{
+			out << "snapshots: game " << game << " restores differently at tick "
+				<< firstDifference << endl;
+			return false;
+		}
+		ticksCompared += tick;
+	}
+	out << "snapshots: " << options.numGames << " games, " << ticksCompared
+		<< " ticks restored the same" << endl;
+	return true;
+}
+
+bool checkRewind(const CheckOptions& options, ostream& out)
+{
+	long ticksCompared = 0;
+	long numRewinds = 0;
+	for (int game = 0; game < options.numGames; game++)
+	{
+		  // afterTick[t - 1] is the world after session tick t the first
+		  // time round
+		vector<uint64_t> afterTick;
+		long tick = 0;
+		long firstDifference = -1;
+		playSeededGame(options, game, [](StudentWorld& world) {
+			world.setRewindLength(REWIND_TICKS);
+		}, [&](StudentWorld& world, int status) {
+			tick++;
+			if (firstDifference >= 0)
+				return;
+			size_t sessionTick = static_cast<size_t>(world.getSessionTick());
+			if (sessionTick > afterTick.size())
+				afterTick.push_back(fingerprint(world));
+			else
+			{
+				ticksCompared++;
+				if (fingerprint(world) != afterTick[sessionTick - 1])
+					firstDifference = tick;
+			}
+			if (status == GWSTATUS_CONTINUE_GAME && tick % TICKS_BETWEEN_REWINDS == 0 &&
+				world.rewind(REWIND_TICKS))
+				numRewinds++;
+		});
+		if (firstDifference >= 0)
+		{
+			out << "rewind: game " << game << " plays differently after a rewind at tick "
+				<< firstDifference << endl;
+			return false;
+		}
+	}
+	out << "rewind: " << options.numGames << " games, " << numRewinds << " rewinds of "
+		<< REWIND_TICKS << " ticks, " << ticksCompared << " ticks replayed the same" << endl;
+	return true;
+}
+
+  // Would a saved game of snapshot, spoilt by spoil, be read back?
+static bool readsSpoiltSave(const WorldSnapshot& snapshot, const function<void(WorldSnapshot&)>& spoil)
+{
+	WorldSnapshot spoilt = snapshot;
+	spoil(spoilt);
+	vector<char> data;
+	encodeSavedGame(spoilt, data);
+	WorldSnapshot read;
+	return decodeSavedGame(data, read);
+}
+
+bool checkSavedGames(const CheckOptions& options, ostream& out)
+{
+	long ticksCompared = 0;
+	for (int game = 0; game < options.numGames; game++)
+	{
+		WorldSnapshot taken;
+		WorldSnapshot read;
+		vector<char> data;
+		long tick = 0;
+		string failure;
+		playSeededGame(options, game, [](StudentWorld&) {}, [&](StudentWorld& world, int) {
+			tick++;
+			if (!failure.empty())
+				return;
+			world.saveSnapshot(taken);
+			encodeSavedGame(taken, data);
+			if (!decodeSavedGame(data, read) || read != taken)
+				failure = "reads back differently";
+			else if (tick % TICKS_BETWEEN_BAD_SAVES == 1)
+			{
+				data.pop_back();
+				if (decodeSavedGame(data, read))
+					failure = "reads a save cut short";
+				else if (readsSpoiltSave(taken, [](WorldSnapshot& spoilt) { spoilt.player.kind = -1; }))
+					failure = "reads a save without a player";
+				else if (!taken.actors.empty() &&
+					readsSpoiltSave(taken, [](WorldSnapshot& spoilt) { spoilt.actors.back().kind = IID_WALL; }))
+					failure = "reads a save with a wall actor";
+				else if (!taken.actors.empty() &&
+					readsSpoiltSave(taken, [](WorldSnapshot& spoilt) { spoilt.actors.back().x = VIEW_WIDTH; }))
+					failure = "reads a save with an actor off the board";
+			}
+			if (!failure.empty())
+				failure += " at tick " + to_string(tick);
+		});
+		if (!failure.empty())
+		{
+			out << "saved games: game " << game << " " << failure << endl;
+			return false;
+		}
+		ticksCompared += tick;
+	}
+	out << "saved games: " << options.numGames << " games, " << ticksCompared
+		<< " ticks saved and read back the same" << endl;
+	return true;
+}
+
+bool checkDeathWithoutActors(const CheckOptions& options, ostream& out)
+{
+	  // Nothing that acts every tick: only walls, marbles, pits, crystals,
+	  // goodies and the exit
+	LevelDensities densities;
+	LevelDensities::preset("typical", densities);
+	densities.rageBots = 0;
+	densities.factories = 0;
+	for (int game = 0; game < options.numGames; game++)
+	{
+		StudentWorld world(options.assetPath);
+		world.setRandomSeed(options.seed + game);
+		HeadlessGame headless(&world);
+		world.loadLevel(LevelGenerator(options.seed + game).generate(densities));
+
+		  // Die after a few quiet ticks, as the player does on their own
+		  // turn by pressing escape
+		int ticksBeforeDying = 1 + game % MAX_TICKS_BEFORE_DYING;
+		int status = GWSTATUS_CONTINUE_GAME;
+		for (int tick = 0; tick < ticksBeforeDying && status == GWSTATUS_CONTINUE_GAME; tick++)
+			status = world.move();
+		int livesBefore = world.getLives();
+		world.getPlayer()->setDead();
+		if (status == GWSTATUS_CONTINUE_GAME)
+			status = world.move();
+		if (status != GWSTATUS_PLAYER_DIED || world.getLives() != livesBefore - 1)
+		{
+			out << "death without actors: game " << game << " plays on after the player dies at tick "
+				<< ticksBeforeDying << endl;
+			return false;
+		}
+	}
+	out << "death without actors: " << options.numGames << " games, every death found the next tick" << endl;
+	return true;
+}
@@ -0,0 +1,44 @@
+#ifndef WORLDCHECKS_H_
+#define WORLDCHECKS_H_
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Self-checks for the ways of running a world that must play exactly like
+// the usual one.  Most play seeded games with random keys through the
+// headless host and compare the world after every tick with how it
+// should be.  Each writes a line to out and returns false at the first
+// difference.  MarbleMadnessHeadless check runs them all.
+
+struct CheckOptions
+{
+	std::string assetPath;
+	int numGames;       // games per check
+	long maxTicks;      // ticks per game at most
+	uint64_t seed;      // game i's world and keys are seeded with seed + i
+};
+
+  // Does a world with two-phase ticks, every tick's decisions split
+  // between threads, play the same as one without?
+bool checkTwoPhaseTicks(const CheckOptions& options, std::ostream& out);
+
+  // Does a snapshot taken after any tick, restored into another world,
+  // give back the same snapshot?
+bool checkSnapshots(const CheckOptions& options, std::ostream& out);
+
+  // Does a world rewound a few ticks now and then, and given the same
+  // keys again, play those ticks the same as the first time?
+bool checkRewind(const CheckOptions& options, std::ostream& out);
+
+  // Does a saved game taken after any tick read back as the same
+  // snapshot, while saves spoilt in ways that would break the world (no
+  // player, an actor that can't be saved or is off the board, a short
+  // file) are refused?
+bool checkSavedGames(const CheckOptions& options, std::ostream& out);
+
+  // On a level where nothing acts every tick, is a player who dies on
+  // their own turn found dead on the next tick?
+bool checkDeathWithoutActors(const CheckOptions& options, std::ostream& out);
+
+#endif // WORLDCHECKS_H_
@@ -0,0 +1,393 @@
+#include "WorldSnapshot.h"
+#include <cstdio>
+#include <fstream>
+using namespace std;
+
+namespace
+{
+	const char SAVE_MAGIC[4] = { 'M', 'M', 'S', 'V' };
+	const uint32_t SAVE_VERSION = 1;
+	const size_t WALL_BYTES = (VIEW_WIDTH * VIEW_HEIGHT + 7) / 8;
+	const size_t RECORD_BYTES = 2 + 4 + 2 + 2 + 2 + 4 + 1 + 4 + 4 + 4 + 4 + 1;
+	const size_t HEADER_BYTES = sizeof(SAVE_MAGIC) + 4 + 6 * 4 + 8 + 4
+		+ 8 * RandomGenerator::STATE_WORDS + WALL_BYTES + RECORD_BYTES + 4;
+
+	const unsigned char VISIBLE = 1 << 0;
+	const unsigned char REVEALED = 1 << 1;
+
+	  // Appends little-endian integers to a buffer
+	class SaveWriter
+	{
+	public:
+		SaveWriter(vector<char>& data)
+		 : m_data(data)
+		{
+		}
+
+		void write(uint64_t value, int numBytes)
+		{
+			for (int i = 0; i < numBytes; i++)
+				m_data.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+		}
+
+		void writeBytes(const char* bytes, size_t numBytes)
+		{
+			for (size_t i = 0; i < numBytes; i++)
+				m_data.push_back(bytes[i]);
+		}
+
+		void writeRecord(const ActorRecord& record)
+		{
+			write(static_cast<uint16_t>(record.kind), 2);
+			write(static_cast<uint32_t>(record.spawnOrder), 4);
+			write(static_cast<uint16_t>(record.x), 2);
+			write(static_cast<uint16_t>(record.y), 2);
+			write(static_cast<uint16_t>(record.direction), 2);
+			write(static_cast<uint32_t>(record.hitPoints), 4);
+			write((record.visible ? VISIBLE : 0) | (record.revealed ? REVEALED : 0), 1);
+			write(static_cast<uint32_t>(record.ammo), 4);
+			write(static_cast<uint32_t>(record.nextActiveTick), 4);
+			write(static_cast<uint32_t>(record.distanceBeforeTurning), 4);
+			write(static_cast<uint32_t>(record.stolenGoodie), 4);
+			write(static_cast<uint8_t>(record.productType), 1);
+		}
+
+	private:
+		vector<char>& m_data;
+	};
+
+	  // Reads little-endian integers from a buffer already known to be
+	  // long enough
+	class SaveReader
+	{
+	public:
+		SaveReader(const vector<char>& data)
+		 : m_data(data), m_pos(0)
+		{
+		}
+
+		uint64_t read(int numBytes)
+		{
+			uint64_t value = readAt(m_pos, numBytes);
+			m_pos += numBytes;
+			return value;
+		}
+
+		uint64_t readAt(size_t pos, int numBytes) const
+		{
+			uint64_t value = 0;
+			for (int i = 0; i < numBytes; i++)
+				value |= uint64_t(static_cast<unsigned char>(m_data[pos + i])) << (8 * i);
+			return value;
+		}
+
+		  // Return the next numBytes bytes as they are
+		const char* readBytes(size_t numBytes)
+		{
+			const char* bytes = &m_data[m_pos];
+			m_pos += numBytes;
+			return bytes;
+		}
+
+		int readInt(int numBytes)
+		{
+			  // Sign-extend from numBytes bytes
+			uint64_t value = read(numBytes);
+			int shift = 64 - 8 * numBytes;
+			return static_cast<int>(static_cast<int64_t>(value << shift) >> shift);
+		}
+
+		void readRecord(ActorRecord& record)
+		{
+			record.kind = readInt(2);
+			record.spawnOrder = readInt(4);
+			record.x = static_cast<int16_t>(readInt(2));
+			record.y = static_cast<int16_t>(readInt(2));
+			record.direction = readInt(2);
+			record.hitPoints = readInt(4);
+			unsigned char flags = static_cast<unsigned char>(read(1));
+			record.visible = (flags & VISIBLE) != 0;
+			record.revealed = (flags & REVEALED) != 0;
+			record.ammo = readInt(4);
+			record.nextActiveTick = readInt(4);
+			record.distanceBeforeTurning = readInt(4);
+			record.stolenGoodie = readInt(4);
+			record.productType = static_cast<int>(read(1));
+		}
+
+	private:
+		const vector<char>& m_data;
+		size_t m_pos;
+	};
+
+	  // Can record be read back as the player, if isPlayer, or as one of
+	  // the other actors?  (Walls are kept in the bitboard, not as actors.)
+	bool isValidRecord(const ActorRecord& record, bool isPlayer)
+	{
+		if (!Bitboard::isOnBoard(record.x, record.y))
+			return false;
+		if (isPlayer)
+			return record.kind == IID_PLAYER;
+		return record.kind > IID_PLAYER && record.kind <= IID_AMMO && record.kind != IID_WALL;
+	}
+}
+
+void encodeSavedGame(const WorldSnapshot& snapshot, vector<char>& data)
+{
+	data.clear();
+	data.reserve(HEADER_BYTES + RECORD_BYTES * snapshot.actors.size());
+	SaveWriter writer(data);
+	writer.writeBytes(SAVE_MAGIC, sizeof(SAVE_MAGIC));
+	writer.write(SAVE_VERSION, 4);
+	writer.write(static_cast<uint32_t>(snapshot.level), 4);
+	writer.write(static_cast<uint32_t>(snapshot.score), 4);
+	writer.write(static_cast<uint32_t>(snapshot.lives), 4);
+	writer.write(static_cast<uint32_t>(snapshot.bonus), 4);
+	writer.write(static_cast<uint32_t>(snapshot.crystalsLeft), 4);
+	writer.write(static_cast<uint32_t>(snapshot.currentTick), 4);
+	writer.write(static_cast<uint64_t>(snapshot.sessionTick), 8);
+	writer.write(static_cast<uint32_t>(snapshot.nextSpawnOrder), 4);
+	for (int i = 0; i < RandomGenerator::STATE_WORDS; i++)
+		writer.write(snapshot.randomState[i], 8);
+	char walls[WALL_BYTES] = {};
+	for (int y = 0; y < VIEW_HEIGHT; y++)
+	{
+		for (int x = 0; x < VIEW_WIDTH; x++)
+		{
+			int bit = y * VIEW_WIDTH + x;
+			if (snapshot.walls.test(x, y))
+				walls[bit / 8] |= 1 << (bit % 8);
+		}
+	}
+	writer.writeBytes(walls, WALL_BYTES);
+	writer.writeRecord(snapshot.player);
+	writer.write(static_cast<uint32_t>(snapshot.actors.size()), 4);
+	for (size_t i = 0; i < snapshot.actors.size(); i++)
+		writer.writeRecord(snapshot.actors[i]);
+}
+
+bool writeSavedGame(string path, const WorldSnapshot& snapshot)
+{
+	vector<char> data;
+	encodeSavedGame(snapshot, data);
+
+	  // Write beside the old save and then replace it, so a crash
+	  // mid-write leaves the old save intact
+	string tempPath = path + ".tmp";
+	{
+		ofstream out(tempPath, ios::binary | ios::trunc);
+		if (!out)
+			return false;
+		out.write(data.data(), data.size());
+		if (!out)
+			return false;
+	}
+	remove(path.c_str());
+	return rename(tempPath.c_str(), path.c_str()) == 0;
+}
+
+bool readSavedGame(string path, WorldSnapshot& snapshot)
+{
+	ifstream in(path, ios::binary | ios::ate);
+	if (!in)
+		return false;
+	streamoff size = in.tellg();
+	if (size < static_cast<streamoff>(HEADER_BYTES))
+		return false;
+	vector<char> data(static_cast<size_t>(size));
+	in.seekg(0);
+	if (!in.read(data.data(), size))
+		return false;
+	return decodeSavedGame(data, snapshot);
+}
+
+bool decodeSavedGame(const vector<char>& data, WorldSnapshot& snapshot)
+{
+	if (data.size() < HEADER_BYTES)
+		return false;
+	SaveReader reader(data);
+	const char* magic = reader.readBytes(sizeof(SAVE_MAGIC));
+	for (size_t i = 0; i < sizeof(SAVE_MAGIC); i++)
+	{
+		if (magic[i] != SAVE_MAGIC[i])
+			return false;
+	}
+	if (reader.read(4) != SAVE_VERSION)
+		return false;
+	  // Check the size against the actor count, the last thing in the
+	  // header, before reading anything into snapshot
+	  // (dividing, as a count near 2^32 would overflow a 32-bit size_t)
+	size_t numActors = static_cast<size_t>(reader.readAt(HEADER_BYTES - 4, 4));
+	if (numActors > (data.size() - HEADER_BYTES) / RECORD_BYTES ||
+		data.size() != HEADER_BYTES + RECORD_BYTES * numActors)
+		return false;
+
+	snapshot.level = reader.readInt(4);
+	snapshot.score = reader.readInt(4);
+	snapshot.lives = reader.readInt(4);
+	snapshot.bonus = reader.readInt(4);
+	snapshot.crystalsLeft = reader.readInt(4);
+	snapshot.currentTick = reader.readInt(4);
+	snapshot.sessionTick = static_cast<long>(reader.read(8));
+	snapshot.nextSpawnOrder = reader.readInt(4);
+	for (int i = 0; i < RandomGenerator::STATE_WORDS; i++)
+		snapshot.randomState[i] = reader.read(8);
+	const char* walls = reader.readBytes(WALL_BYTES);
+	snapshot.walls.clear();
+	for (int y = 0; y < VIEW_HEIGHT; y++)
+	{
+		for (int x = 0; x < VIEW_WIDTH; x++)
+		{
+			int bit = y * VIEW_WIDTH + x;
+			if (walls[bit / 8] & (1 << (bit % 8)))
+				snapshot.walls.set(x, y);
+		}
+	}
+	reader.readRecord(snapshot.player);
+	if (!isValidRecord(snapshot.player, true))
+		return false;
+	reader.read(4);
+	snapshot.actors.resize(numActors);
+	for (size_t i = 0; i < numActors; i++)
+	{
+		reader.readRecord(snapshot.actors[i]);
+		if (!isValidRecord(snapshot.actors[i], false))
+			return false;
+		if (i > 0 && snapshot.actors[i].spawnOrder <= snapshot.actors[i - 1].spawnOrder)
+			return false;
+	}
+	return true;
+}
+
+RewindBuffer::RewindBuffer(int capacity, int ticksPerKeyframe)
+ : m_capacity(capacity), m_ticksPerKeyframe(ticksPerKeyframe), m_size(0)
+{
+	if (m_ticksPerKeyframe < 1)
+		m_ticksPerKeyframe = 1;
+}
+
+void RewindBuffer::setCapacity(int capacity)
+{
+	clear();
+	m_capacity = capacity;
+}
+
+void RewindBuffer::clear()
+{
+	m_runs.clear();
+	m_newest.actors.clear();
+	m_size = 0;
+}
+
+void RewindBuffer::record(const WorldSnapshot& snapshot)
+{
+	if (m_capacity <= 0)
+		return;
+
+	if (m_runs.empty() || m_runs.back().size() >= static_cast<size_t>(m_ticksPerKeyframe))
+	{
+		m_runs.push_back(vector<Entry>());
+		m_runs.back().push_back(Entry());
+		m_runs.back().back().state = snapshot;
+	}
+	else
+	{
+		m_runs.back().push_back(Entry());
+		makeDelta(m_newest, snapshot, m_runs.back().back());
+	}
+	m_newest = snapshot;
+	m_size++;
+
+	  // Drop the oldest run as long as the rest still hold enough
+	while (m_size - static_cast<int>(m_runs.front().size()) >= m_capacity)
+	{
+		m_size -= static_cast<int>(m_runs.front().size());
+		m_runs.pop_front();
+	}
+}
+
+bool RewindBuffer::rewind(int numBack, WorldSnapshot& snapshot)
+{
+	if (numBack < 0 || numBack >= m_size)
+		return false;
+
+	  // Find the run holding the snapshot wanted, then rebuild it from the
+	  // run's keyframe
+	int index = m_size - 1 - numBack;
+	size_t run = 0;
+	while (index >= static_cast<int>(m_runs[run].size()))
+	{
+		index -= static_cast<int>(m_runs[run].size());
+		run++;
+	}
+	vector<Entry>& entries = m_runs[run];
+	snapshot = entries[0].state;
+	for (int i = 1; i <= index; i++)
+		applyDelta(entries[i], snapshot);
+
+	entries.resize(index + 1);
+	m_runs.resize(run + 1);
+	m_size -= numBack;
+	m_newest = snapshot;
+	return true;
+}
+
+void RewindBuffer::makeDelta(const WorldSnapshot& from, const WorldSnapshot& to, Entry& delta)
+{
+	  // Both lists are in spawn order, so one pass over the two finds
+	  // every actor that came, went or changed
+	const vector<ActorRecord>& before = from.actors;
+	const vector<ActorRecord>& after = to.actors;
+	delta.state = to;
+	delta.state.actors.clear();
+	delta.removed.clear();
+	size_t b = 0;
+	size_t a = 0;
+	while (b < before.size() || a < after.size())
+	{
+		if (a == after.size() || (b < before.size() && before[b].spawnOrder < after[a].spawnOrder))
+			delta.removed.push_back(before[b++].spawnOrder);
+		else if (b == before.size() || after[a].spawnOrder < before[b].spawnOrder)
+			delta.state.actors.push_back(after[a++]);
+		else
+		{
+			if (before[b] != after[a])
+				delta.state.actors.push_back(after[a]);
+			b++;
+			a++;
+		}
+	}
+}
+
+void RewindBuffer::applyDelta(const Entry& delta, WorldSnapshot& state)
+{
+	vector<ActorRecord> actors;
+	actors.reserve(state.actors.size() + delta.state.actors.size());
+	const vector<ActorRecord>& before = state.actors;
+	const vector<ActorRecord>& changed = delta.state.actors;
+	const vector<int>& removed = delta.removed;
+	size_t b = 0;
+	size_t c = 0;
+	size_t r = 0;
+	while (b < before.size() || c < changed.size())
+	{
+		if (c == changed.size() || (b < before.size() && before[b].spawnOrder < changed[c].spawnOrder))
+		{
+			while (r < removed.size() && removed[r] < before[b].spawnOrder)
+				r++;
+			if (r == removed.size() || removed[r] != before[b].spawnOrder)
+				actors.push_back(before[b]);
+			b++;
+		}
+		else
+		{
+			if (b < before.size() && before[b].spawnOrder == changed[c].spawnOrder)
+				b++;
+			actors.push_back(changed[c++]);
+		}
+	}
+
+	  // Everything else in a delta is whole
+	state = delta.state;
+	state.actors.swap(actors);
+}
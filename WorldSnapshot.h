@@ -0,0 +1,152 @@
+#ifndef WORLDSNAPSHOT_H_
+#define WORLDSNAPSHOT_H_
+
+#include "Bitboard.h"
+#include "RandomGenerator.h"
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <vector>
+
+// The state of a StudentWorld between two ticks, as plain values: enough
+// to put the world back exactly as it was, so that it plays on the same
+// way given the same keys.  Taking one copies a few dozen bytes per actor;
+// nothing in it points into the world.
+
+  // One actor.  The fields after visible are used by some kinds only.
+struct ActorRecord
+{
+	int kind;           // image ID
+	int spawnOrder;
+	int16_t x;
+	int16_t y;
+	int direction;
+	int hitPoints;
+	bool visible;
+	bool revealed;              // Exit
+	int ammo;                   // Player
+	int nextActiveTick;         // robots
+	int distanceBeforeTurning;  // ThiefBots
+	int stolenGoodie;           // ThiefBots: spawn order of the goodie held, or -1
+	int productType;            // ThiefBotFactory
+};
+
+inline bool operator==(const ActorRecord& a, const ActorRecord& b)
+{
+	return a.kind == b.kind && a.spawnOrder == b.spawnOrder && a.x == b.x && a.y == b.y &&
+		a.direction == b.direction && a.hitPoints == b.hitPoints && a.visible == b.visible &&
+		a.revealed == b.revealed && a.ammo == b.ammo && a.nextActiveTick == b.nextActiveTick &&
+		a.distanceBeforeTurning == b.distanceBeforeTurning && a.stolenGoodie == b.stolenGoodie &&
+		a.productType == b.productType;
+}
+
+inline bool operator!=(const ActorRecord& a, const ActorRecord& b)
+{
+	return !(a == b);
+}
+
+struct WorldSnapshot
+{
+	int level;
+	int score;
+	int lives;
+	int bonus;
+	int crystalsLeft;
+	int currentTick;
+	long sessionTick;
+	int nextSpawnOrder;
+	uint64_t randomState[RandomGenerator::STATE_WORDS];
+	Bitboard walls;
+	ActorRecord player;         // kind is -1 if no level is in play
+	std::vector<ActorRecord> actors;  // in spawn order
+};
+
+inline bool operator==(const WorldSnapshot& a, const WorldSnapshot& b)
+{
+	for (int i = 0; i < RandomGenerator::STATE_WORDS; i++)
+	{
+		if (a.randomState[i] != b.randomState[i])
+			return false;
+	}
+	return a.level == b.level && a.score == b.score && a.lives == b.lives && a.bonus == b.bonus &&
+		a.crystalsLeft == b.crystalsLeft && a.currentTick == b.currentTick &&
+		a.sessionTick == b.sessionTick && a.nextSpawnOrder == b.nextSpawnOrder &&
+		a.walls == b.walls && a.player == b.player && a.actors == b.actors;
+}
+
+inline bool operator!=(const WorldSnapshot& a, const WorldSnapshot& b)
+{
+	return !(a == b);
+}
+
+  // Write snapshot to a saved game file at path, or read one back.  The
+  // file is versioned and little-endian, fixed-size records throughout:
+  //   "MMSV", 4-byte version, the world's counters and random state, the
+  //   walls as one bit per square, the player, a 4-byte actor count,
+  //   then the actors
+  // A reader takes the whole file in one read and rejects it unless its
+  // size matches its actor count, it has a player, and every actor is of
+  // a kind that can be saved, on the board and in spawn order.  Return
+  // false if the file can't be written or isn't a saved game of this
+  // version; snapshot may then have been partly read into.
+bool writeSavedGame(std::string path, const WorldSnapshot& snapshot);
+bool readSavedGame(std::string path, WorldSnapshot& snapshot);
+
+  // The same, to and from a saved game's bytes in memory
+void encodeSavedGame(const WorldSnapshot& snapshot, std::vector<char>& data);
+bool decodeSavedGame(const std::vector<char>& data, WorldSnapshot& snapshot);
+
+  // The snapshots of the last so many ticks, for stepping a world back.
+  // Every ticksPerKeyframe-th snapshot is kept whole; the ones between
+  // keep only the actors that changed since the one before, which is
+  // usually a handful.  Once more than capacity snapshots are kept, the
+  // oldest run of a keyframe and its deltas is dropped.
+class RewindBuffer
+{
+public:
+	RewindBuffer(int capacity = 0, int ticksPerKeyframe = 32);
+
+	  // Keep up to capacity snapshots, dropping all kept so far.  With a
+	  // capacity of 0, nothing is kept.
+	void setCapacity(int capacity);
+	int getCapacity() const
+	{
+		return m_capacity;
+	}
+
+	  // How many snapshots are kept
+	int size() const
+	{
+		return m_size;
+	}
+
+	void clear();
+
+	  // Keep snapshot as the newest
+	void record(const WorldSnapshot& snapshot);
+
+	  // Set snapshot to the one numBack snapshots before the newest and
+	  // forget every one newer, so recording can carry on from there.
+	  // Return false, changing nothing, unless more than numBack are kept.
+	bool rewind(int numBack, WorldSnapshot& snapshot);
+
+private:
+	  // A keyframe, or the actors that are new or changed since the
+	  // snapshot before it plus the spawn orders of those that are gone
+	struct Entry
+	{
+		WorldSnapshot state;
+		std::vector<int> removed;
+	};
+
+	std::deque<std::vector<Entry> > m_runs;  // each starts with a keyframe
+	WorldSnapshot m_newest;
+	int m_capacity;
+	int m_ticksPerKeyframe;
+	int m_size;
+
+	static void makeDelta(const WorldSnapshot& from, const WorldSnapshot& to, Entry& delta);
+	static void applyDelta(const Entry& delta, WorldSnapshot& state);
+};
+
+#endif // WORLDSNAPSHOT_H_